@@ -0,0 +1,41 @@
+# Archive code and its C API (pak.h), usable without QtWidgets. See
+# ../pakc for a shared library exporting the C API to other languages.
+
+QT       = core
+
+TEMPLATE = lib
+TARGET = pak
+
+CONFIG += c++11 staticlib
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+SOURCES += \
+    pak.cpp \
+    pakbatch.cpp \
+    pakbuffer.cpp \
+    pakbuilder.cpp \
+    pakfile.cpp \
+    pakio.cpp \
+    paklayout.cpp \
+    pakverifier.cpp
+
+HEADERS += \
+    pak.h \
+    pakbatch.h \
+    pakbuffer.h \
+    pakbuilder.h \
+    pakfile.h \
+    pakio.h \
+    paklayout.h \
+    pakverifier.h
+
+# Optional io_uring backend for PakIo (Linux, needs liburing). Pass the same
+# CONFIG to the top-level qmake so the programs link liburing too.
+pak_io_uring {
+    DEFINES += PAK_HAVE_IO_URING
+    SOURCES += pakuringio.cpp
+    HEADERS += pakuringio.h
+}
@@ -0,0 +1,367 @@
+#include "pak.h"
+
+#include <QHash>
+#include <QScopedPointer>
+
+#include <cstring>
+
+#include "pakfile.h"
+
+struct pak_file
+{
+    QScopedPointer<PakFile> pakFile;
+    QByteArray error;
+
+    // UTF-8 names handed out by pak_name() and the lookup for pak_find(),
+    // both built on first use and dropped whenever the resources change
+    QVector<QByteArray> names;
+    QHash<QString, int> nameIndex;
+};
+
+// pak_open() has no handle to store its error in
+static thread_local QByteArray openError;
+
+static int fail(pak_file* pak, const QString& message)
+{
+    pak->error = message.toUtf8();
+    return -1;
+}
+
+static bool checkIndex(pak_file* pak, int index)
+{
+    if (index < 0 || index >= pak->pakFile->resources.count())
+    {
+        fail(pak, QString("Resource index %1 is out of range").arg(index));
+        return false;
+    }
+
+    return true;
+}
+
+static void resourcesChanged(pak_file* pak)
+{
+    pak->pakFile->unsaved = true;
+    pak->names.clear();
+    pak->nameIndex.clear();
+}
+
+static bool makeResource(pak_file* pak, PakFile::Resource& resource, const char* name,
+                         const void* data, uint64_t size)
+{
+    if (size > 0x7FFFFFFF || (size > 0 && !data))
+    {
+        fail(pak, "Resource data is too big or missing");
+        return false;
+    }
+
+    resource.name = QString::fromUtf8(name);
+    resource.buffer = PakMemoryBuffer::create(QByteArray(static_cast<const char*>(data), static_cast<int>(size)));
+    resource.offset = 0;
+    resource.size = static_cast<quint32>(size);
+
+    return true;
+}
+
+static bool loadResource(pak_file* pak, PakFile::Resource& resource, const char* path)
+{
+    QString filePath = QString::fromUtf8(path);
+
+    if (!pak->pakFile->loadResource(resource, filePath))
+    {
+        fail(pak, QString("Could not load %1").arg(filePath));
+        return false;
+    }
+
+    return true;
+}
+
+int pak_abi_version(void)
+{
+    return PAK_ABI_VERSION;
+}
+
+pak_file* pak_open(const char* path)
+{
+    if (!path)
+    {
+        openError = "No path given";
+        return nullptr;
+    }
+
+    QString filePath = QString::fromUtf8(path);
+    PakFile* pakFile = PakFile::open(filePath);
+
+    if (!pakFile)
+    {
+        openError = QString("Could not open %1 or it is not a valid PAK file").arg(filePath).toUtf8();
+        return nullptr;
+    }
+
+    pak_file* pak = new pak_file;
+    pak->pakFile.reset(pakFile);
+
+    return pak;
+}
+
+pak_file* pak_create(void)
+{
+    pak_file* pak = new pak_file;
+    pak->pakFile.reset(new PakFile);
+
+    return pak;
+}
+
+void pak_close(pak_file* pak)
+{
+    delete pak;
+}
+
+int pak_count(const pak_file* pak)
+{
+    return pak->pakFile->resources.count();
+}
+
+const char* pak_name(pak_file* pak, int index)
+{
+    if (!checkIndex(pak, index))
+    {
+        return nullptr;
+    }
+
+    if (pak->names.isEmpty())
+    {
+        pak->names.reserve(pak->pakFile->resources.count());
+
+        for (const PakFile::Resource& resource : pak->pakFile->resources)
+        {
+            pak->names.append(resource.name.toUtf8());
+        }
+    }
+
+    return pak->names[index].constData();
+}
+
+int pak_find(pak_file* pak, const char* name)
+{
+    const QVector<PakFile::Resource>& resources = pak->pakFile->resources;
+
+    if (pak->nameIndex.isEmpty() && !resources.isEmpty())
+    {
+        pak->nameIndex.reserve(resources.count());
+
+        // Walk backwards so the first of several equal names wins
+        for (int i = resources.count() - 1; i >= 0; i--)
+        {
+            pak->nameIndex.insert(resources[i].name, i);
+        }
+    }
+
+    return pak->nameIndex.value(QString::fromUtf8(name), -1);
+}
+
+int64_t pak_size(const pak_file* pak, int index)
+{
+    if (index < 0 || index >= pak->pakFile->resources.count())
+    {
+        return -1;
+    }
+
+    return pak->pakFile->resources[index].size;
+}
+
+int64_t pak_read(pak_file* pak, int index, uint64_t offset, void* buffer, uint64_t length)
+{
+    if (!checkIndex(pak, index))
+    {
+        return -1;
+    }
+
+    const PakFile::Resource& resource = pak->pakFile->resources[index];
+
+    if (offset > resource.size)
+    {
+        return fail(pak, "Read starts past the end of the resource");
+    }
+
+    quint32 count = static_cast<quint32>(qMin<uint64_t>(length, resource.size - offset));
+    const char* data = resource.data();
+
+    if (data)
+    {
+        memcpy(buffer, data + offset, count);
+    }
+    else if (!resource.read(static_cast<quint32>(offset), static_cast<char*>(buffer), count))
+    {
+        return fail(pak, QString("Could not read %1").arg(resource.name));
+    }
+
+    return count;
+}
+
+const void* pak_data(const pak_file* pak, int index)
+{
+    if (index < 0 || index >= pak->pakFile->resources.count())
+    {
+        return nullptr;
+    }
+
+    return pak->pakFile->resources[index].data();
+}
+
+int pak_add(pak_file* pak, const char* name, const void* data, uint64_t size)
+{
+    PakFile::Resource resource;
+
+    if (!makeResource(pak, resource, name, data, size))
+    {
+        return -1;
+    }
+
+    pak->pakFile->resources.append(resource);
+    resourcesChanged(pak);
+
+    return 0;
+}
+
+int pak_add_file(pak_file* pak, const char* name, const char* path)
+{
+    PakFile::Resource resource;
+
+    if (!loadResource(pak, resource, path))
+    {
+        return -1;
+    }
+
+    if (name)
+    {
+        resource.name = QString::fromUtf8(name);
+    }
+
+    pak->pakFile->resources.append(resource);
+    resourcesChanged(pak);
+
+    return 0;
+}
+
+int pak_replace(pak_file* pak, int index, const void* data, uint64_t size)
+{
+    if (!checkIndex(pak, index))
+    {
+        return -1;
+    }
+
+    PakFile::Resource& resource = pak->pakFile->resources[index];
+    QByteArray name = resource.name.toUtf8();
+
+    if (!makeResource(pak, resource, name.constData(), data, size))
+    {
+        return -1;
+    }
+
+    resourcesChanged(pak);
+
+    return 0;
+}
+
+int pak_replace_file(pak_file* pak, int index, const char* path)
+{
+    if (!checkIndex(pak, index))
+    {
+        return -1;
+    }
+
+    PakFile::Resource resource;
+
+    if (!loadResource(pak, resource, path))
+    {
+        return -1;
+    }
+
+    // Replacing keeps the name the resource already has
+    resource.name = pak->pakFile->resources[index].name;
+    pak->pakFile->resources[index] = resource;
+    resourcesChanged(pak);
+
+    return 0;
+}
+
+int pak_remove(pak_file* pak, int index)
+{
+    if (!checkIndex(pak, index))
+    {
+        return -1;
+    }
+
+    pak->pakFile->deleteResource(index);
+    resourcesChanged(pak);
+
+    return 0;
+}
+
+int pak_configure(pak_file* pak, int endian, uint32_t sectorSize, uint32_t sizeAlign)
+{
+    if (endian != PAK_BIG_ENDIAN && endian != PAK_LITTLE_ENDIAN)
+    {
+        return fail(pak, QString("Unknown endian %1").arg(endian));
+    }
+
+    // Padding is computed with masks, so alignments must be powers of two
+    if (sectorSize & (sectorSize - 1))
+    {
+        return fail(pak, QString("Sector size %1 is not a power of two").arg(sectorSize));
+    }
+
+    if (sizeAlign & (sizeAlign - 1))
+    {
+        return fail(pak, QString("Size alignment %1 is not a power of two").arg(sizeAlign));
+    }
+
+    PakFile* pakFile = pak->pakFile.data();
+
+    pakFile->endian = static_cast<PakFile::Endian>(endian);
+
+    if (sectorSize)
+    {
+        pakFile->sectorSize = sectorSize;
+    }
+
+    if (sizeAlign)
+    {
+        pakFile->sizeAlign = sizeAlign;
+    }
+
+    pakFile->unsaved = true;
+
+    return 0;
+}
+
+int pak_save(pak_file* pak, const char* path)
+{
+    PakFile* pakFile = pak->pakFile.data();
+    QString oldPath = pakFile->path;
+
+    if (path)
+    {
+        pakFile->path = QString::fromUtf8(path);
+    }
+
+    if (pakFile->path.isEmpty())
+    {
+        return fail(pak, "No path to save to");
+    }
+
+    if (!pakFile->save())
+    {
+        QString failedPath = pakFile->path;
+        pakFile->path = oldPath;
+
+        return fail(pak, QString("Could not write %1").arg(failedPath));
+    }
+
+    return 0;
+}
+
+const char* pak_last_error(const pak_file* pak)
+{
+    return pak ? pak->error.constData() : openError.constData();
+}
@@ -0,0 +1,104 @@
+#ifndef PAK_H
+#define PAK_H
+
+/*
+ * C API for reading and writing PAK archives without Qt or C++, so tools in
+ * other languages can keep archives open in-process. Link against the
+ * static libpak, or the shared pakc library (define PAK_SHARED when using
+ * its import library on Windows).
+ *
+ * Functions returning int return 0 on success and -1 on failure, with the
+ * reason available from pak_last_error(). Strings are UTF-8. A handle must
+ * not be used from several threads at once; separate handles are
+ * independent.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(PAK_SHARED_BUILD)
+#  if defined(_WIN32)
+#    define PAK_API __declspec(dllexport)
+#  else
+#    define PAK_API __attribute__((visibility("default")))
+#  endif
+#elif defined(PAK_SHARED) && defined(_WIN32)
+#  define PAK_API __declspec(dllimport)
+#else
+#  define PAK_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a signature or behaviour below changes incompatibly */
+#define PAK_ABI_VERSION 1
+
+#define PAK_BIG_ENDIAN 0
+#define PAK_LITTLE_ENDIAN 1
+
+typedef struct pak_file pak_file;
+
+PAK_API int pak_abi_version(void);
+
+/* Opens an archive, or returns NULL. The data is mapped, not read. */
+PAK_API pak_file* pak_open(const char* path);
+
+/* Creates an empty, unsaved archive */
+PAK_API pak_file* pak_create(void);
+
+PAK_API void pak_close(pak_file* pak);
+
+/* Resources are numbered 0 to pak_count() - 1 in table order. Adding or
+ * removing resources renumbers them. */
+PAK_API int pak_count(const pak_file* pak);
+
+/* Valid until the archive is next modified or closed */
+PAK_API const char* pak_name(pak_file* pak, int index);
+
+/* Index of the first resource with this name, or -1 */
+PAK_API int pak_find(pak_file* pak, const char* name);
+
+/* Size in bytes, or -1 for a bad index */
+PAK_API int64_t pak_size(const pak_file* pak, int index);
+
+/* Copies length bytes from offset into buffer. Returns the number of bytes
+ * copied, which is less than length at the end of the resource, or -1. */
+PAK_API int64_t pak_read(pak_file* pak, int index, uint64_t offset, void* buffer, uint64_t length);
+
+/* Pointer to the resource data without copying it, or NULL when the data
+ * isn't in memory or a mapping (use pak_read then). Valid until the
+ * archive is next modified, saved or closed. */
+PAK_API const void* pak_data(const pak_file* pak, int index);
+
+/* Appends a resource with a copy of the data */
+PAK_API int pak_add(pak_file* pak, const char* name, const void* data, uint64_t size);
+
+/* Appends a resource loaded from a file. Large files are spilled to a
+ * temporary file rather than held in memory. */
+PAK_API int pak_add_file(pak_file* pak, const char* name, const char* path);
+
+PAK_API int pak_replace(pak_file* pak, int index, const void* data, uint64_t size);
+PAK_API int pak_replace_file(pak_file* pak, int index, const char* path);
+PAK_API int pak_remove(pak_file* pak, int index);
+
+/* Settings used by the next save. Pass 0 to keep the current sector size
+ * or size alignment; other values must be powers of two. */
+PAK_API int pak_configure(pak_file* pak, int endian, uint32_t sectorSize, uint32_t sizeAlign);
+
+/* Saves to path, or back to the path it was opened from or last saved to
+ * when path is NULL. Pointers from pak_data() are invalid afterwards. On
+ * Windows, saving over a file that another handle or process has open
+ * fails. */
+PAK_API int pak_save(pak_file* pak, const char* path);
+
+/* Reason for the last failure on this handle, or on pak_open() when pak is
+ * NULL. Never NULL. */
+PAK_API const char* pak_last_error(const pak_file* pak);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PAK_H */
@@ -0,0 +1,355 @@
+#include "pakbatch.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <climits>
+
+#include "pakfile.h"
+#include "paklayout.h"
+#include "pakverifier.h"
+
+#define MIB (1024 * 1024)
+
+// Processes one archive of a batch
+class PakBatchTask : public QRunnable
+{
+public:
+    PakBatchTask(const PakBatch* batch, PakBatch::Result* result, QSemaphore* memory)
+        : batch(batch), result(result), memory(memory)
+    {
+    }
+
+    void run() override
+    {
+        batch->process(*result, memory);
+    }
+
+private:
+    const PakBatch* batch;
+    PakBatch::Result* result;
+    QSemaphore* memory;
+};
+
+PakBatch::Result::Result()
+{
+    success = false;
+    resourceCount = 0;
+    pakSize = 0;
+    dataSize = 0;
+    padding = 0;
+    outputSize = 0;
+    milliseconds = 0;
+}
+
+PakBatch::PakBatch()
+{
+    operation = PAKBATCH_STATS;
+    threadCount = 0;
+    memoryBudget = 1024 * MIB;
+    endian = -1;
+    sectorSize = 0;
+    sizeAlign = 0;
+    milliseconds = 0;
+}
+
+QString PakBatch::operationName(Operation operation)
+{
+    switch (operation)
+    {
+    case PAKBATCH_LIST:
+        return "list";
+    case PAKBATCH_VERIFY:
+        return "verify";
+    case PAKBATCH_EXTRACT:
+        return "extract";
+    case PAKBATCH_REPACK:
+        return "repack";
+    default:
+        return "stats";
+    }
+}
+
+bool PakBatch::parseOperation(const QString& name, Operation* operation)
+{
+    for (int i = PAKBATCH_LIST; i <= PAKBATCH_STATS; i++)
+    {
+        if (name == operationName(static_cast<Operation>(i)))
+        {
+            *operation = static_cast<Operation>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool PakBatch::run(const QString& inputPath)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    this->inputPath = inputPath;
+    results.clear();
+
+    QDir inputDir(inputPath);
+    QString outputPrefix = outputPath.isEmpty() ? QString() : QDir(outputPath).absolutePath() + '/';
+    QDirIterator it(inputPath, QStringList() << "*.pak", QDir::Files, QDirIterator::Subdirectories);
+    QVector<quint64> sizes;
+
+    while (it.hasNext())
+    {
+        it.next();
+
+        // Don't pick up what an earlier run wrote to an output directory
+        // inside the input directory
+        if (!outputPrefix.isEmpty() && it.fileInfo().absoluteFilePath().startsWith(outputPrefix))
+        {
+            continue;
+        }
+
+        Result result;
+        result.path = inputDir.relativeFilePath(it.filePath());
+        results.append(result);
+    }
+
+    std::sort(results.begin(), results.end(), [](const Result& a, const Result& b) { return a.path < b.path; });
+
+    QVector<int> order(results.count());
+
+    for (int i = 0; i < results.count(); i++)
+    {
+        order[i] = i;
+        sizes.append(QFileInfo(inputDir.filePath(results[i].path)).size());
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&sizes](int a, int b) { return sizes[a] > sizes[b]; });
+
+    // Archives are the unit of work, so verification inside each one stays
+    // on its own pool thread instead of starting another pool
+    QThreadPool pool;
+    QSemaphore memory(memoryBudgetMiB());
+    Result* resultData = results.data();
+
+    pool.setMaxThreadCount(threadCount > 0 ? threadCount : QThread::idealThreadCount());
+
+    for (int index : order)
+    {
+        pool.start(new PakBatchTask(this, resultData + index, &memory));
+    }
+
+    pool.waitForDone();
+
+    milliseconds = timer.elapsed();
+
+    for (const Result& result : results)
+    {
+        if (!result.success)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool PakBatch::writeReport(const QString& path) const
+{
+    QJsonArray archives;
+    int failed = 0;
+    qint64 resourceCount = 0;
+    quint64 pakSize = 0;
+    quint64 dataSize = 0;
+    quint64 padding = 0;
+    qint64 archiveMilliseconds = 0;
+
+    for (const Result& result : results)
+    {
+        QJsonObject archive;
+        archive["path"] = result.path;
+        archive["success"] = result.success;
+        archive["errors"] = QJsonArray::fromStringList(result.errors);
+        archive["resources"] = result.resourceCount;
+        archive["pakSize"] = static_cast<qint64>(result.pakSize);
+        archive["dataSize"] = static_cast<qint64>(result.dataSize);
+        archive["padding"] = static_cast<qint64>(result.padding);
+        archive["milliseconds"] = result.milliseconds;
+
+        if (operation == PAKBATCH_REPACK)
+        {
+            archive["outputSize"] = static_cast<qint64>(result.outputSize);
+        }
+
+        if (operation == PAKBATCH_LIST)
+        {
+            archive["list"] = QJsonArray::fromStringList(result.resources);
+        }
+
+        archives.append(archive);
+
+        failed += result.success ? 0 : 1;
+        resourceCount += result.resourceCount;
+        pakSize += result.pakSize;
+        dataSize += result.dataSize;
+        padding += result.padding;
+        archiveMilliseconds += result.milliseconds;
+    }
+
+    QJsonObject report;
+    report["operation"] = operationName(operation);
+    report["input"] = inputPath;
+    report["archives"] = results.count();
+    report["failed"] = failed;
+    report["resources"] = resourceCount;
+    report["pakSize"] = static_cast<qint64>(pakSize);
+    report["dataSize"] = static_cast<qint64>(dataSize);
+    report["padding"] = static_cast<qint64>(padding);
+    report["milliseconds"] = milliseconds;
+    report["archiveMilliseconds"] = archiveMilliseconds;
+    report["results"] = archives;
+
+    QFile file(path);
+
+    if (!file.open(QFile::WriteOnly))
+    {
+        return false;
+    }
+
+    QByteArray json = QJsonDocument(report).toJson();
+
+    return file.write(json) == json.size();
+}
+
+int PakBatch::memoryBudgetMiB() const
+{
+    return static_cast<int>(qBound<quint64>(1, memoryBudget / MIB, INT_MAX));
+}
+
+void PakBatch::process(Result& result, QSemaphore* memory) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QString path = QDir(inputPath).filePath(result.path);
+    QScopedPointer<PakFile> pakFile(PakFile::open(path));
+
+    if (!pakFile)
+    {
+        result.errors.append(QString("Could not open %1 or it is not a valid PAK file").arg(path));
+        result.milliseconds = timer.elapsed();
+        return;
+    }
+
+    PakLayout layout = PakLayout::analyze(*pakFile);
+
+    result.resourceCount = pakFile->resources.count();
+    result.pakSize = layout.pakSize;
+    result.dataSize = layout.dataSize;
+    result.padding = layout.wasted();
+
+    if (operation == PAKBATCH_LIST)
+    {
+        for (const PakFile::Resource& resource : pakFile->resources)
+        {
+            result.resources.append(QString("%1\t%2").arg(resource.name).arg(resource.size));
+        }
+    }
+    else if (operation != PAKBATCH_STATS)
+    {
+        // Opening only read the table; this goes through all the data
+        int reserved = static_cast<int>(qBound<quint64>(1, (result.dataSize + MIB - 1) / MIB, memoryBudgetMiB()));
+        memory->acquire(reserved);
+
+        if (operation == PAKBATCH_VERIFY)
+        {
+            PakVerifier verifier;
+            verifier.threadCount = 1;
+
+            if (!verifier.verify(path))
+            {
+                result.errors = verifier.errors;
+            }
+        }
+        else if (operation == PAKBATCH_EXTRACT)
+        {
+            QString archivePath = result.path.endsWith(".pak", Qt::CaseInsensitive) ? result.path.chopped(4) : result.path;
+            QDir targetDir(QDir(outputPath).filePath(archivePath));
+            QString targetPrefix = QDir::cleanPath(targetDir.absolutePath()) + '/';
+
+            for (const PakFile::Resource& resource : pakFile->resources)
+            {
+                // Names come from the archive, so absolute ones and ones with
+                // enough ".." to leave the target directory are refused
+                QString filePath = QDir::cleanPath(targetDir.absoluteFilePath(QDir::fromNativeSeparators(resource.name)));
+
+                if (!filePath.startsWith(targetPrefix))
+                {
+                    result.errors.append(QString("Resource name %1 points outside the output directory").arg(resource.name));
+                    continue;
+                }
+
+                QFile file(filePath);
+                QVector<PakIo::Write> writes;
+
+                writes.append(resource.writeRequest(0));
+                QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+                if (!file.open(QFile::WriteOnly) || !PakIo::instance()->write(&file, writes, resource.size))
+                {
+                    result.errors.append(QString("Could not write %1").arg(filePath));
+                    break;
+                }
+            }
+        }
+        else if (operation == PAKBATCH_REPACK)
+        {
+            QString outputFilePath = QDir(outputPath).filePath(result.path);
+
+            if (endian >= 0)
+            {
+                pakFile->endian = static_cast<PakFile::Endian>(endian);
+            }
+
+            pakFile->keepDiskAlignment();
+
+            if (sectorSize)
+            {
+                pakFile->sectorSize = sectorSize;
+            }
+
+            if (sizeAlign)
+            {
+                pakFile->sizeAlign = sizeAlign;
+            }
+
+            pakFile->path = outputFilePath;
+            QDir().mkpath(QFileInfo(outputFilePath).absolutePath());
+
+            if (pakFile->save())
+            {
+                result.outputSize = QFileInfo(outputFilePath).size();
+            }
+            else
+            {
+                result.errors.append(QString("Could not write %1").arg(outputFilePath));
+            }
+        }
+
+        memory->release(reserved);
+    }
+
+    result.success = result.errors.isEmpty();
+    result.milliseconds = timer.elapsed();
+}
@@ -0,0 +1,89 @@
+#ifndef PAKBATCH_H
+#define PAKBATCH_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QSemaphore;
+
+// Runs one operation over every PAK file in a directory tree. Archives are
+// processed in parallel, one pool thread each, biggest first so that one
+// large archive doesn't start last and hold up the end of the batch.
+// Operations that go through all the resource data (verify, extract and
+// repack) also reserve their archive's data size, capped at memoryBudget,
+// from memoryBudget before starting, which bounds how much archive data is
+// being worked on at once.
+class PakBatch
+{
+public:
+    enum Operation
+    {
+        PAKBATCH_LIST = 0,
+        PAKBATCH_VERIFY = 1,
+        PAKBATCH_EXTRACT = 2,
+        PAKBATCH_REPACK = 3,
+        PAKBATCH_STATS = 4
+    };
+
+    struct Result
+    {
+        // Relative to the input directory
+        QString path;
+
+        bool success;
+        QStringList errors;
+        int resourceCount;
+        quint64 pakSize;
+        quint64 dataSize;
+        quint64 padding;
+
+        // Size of the repacked archive
+        quint64 outputSize;
+
+        // Names and sizes of the resources, for PAKBATCH_LIST
+        QStringList resources;
+
+        qint64 milliseconds;
+
+        Result();
+    };
+
+    PakBatch();
+
+    static QString operationName(Operation operation);
+    static bool parseOperation(const QString& name, Operation* operation);
+
+    // Processes every .pak file under inputPath. Extracted resources go to
+    // outputPath/<archive path without .pak>/ (resources whose names would
+    // land outside it are skipped as errors) and repacked archives to
+    // outputPath/<archive path>. Returns false if any archive failed.
+    bool run(const QString& inputPath);
+
+    // JSON report with the totals and a result per archive
+    bool writeReport(const QString& path) const;
+
+    Operation operation;
+    QString outputPath;
+    int threadCount;
+    quint64 memoryBudget;
+
+    // Settings for repacked archives. -1 keeps the archive's endianness;
+    // 0 keeps the default alignment unless the archive's padding doesn't
+    // fit it (see PakFile::keepDiskAlignment()).
+    int endian;
+    quint32 sectorSize;
+    quint32 sizeAlign;
+
+    QString inputPath;
+    QVector<Result> results;
+    qint64 milliseconds;
+
+private:
+    friend class PakBatchTask;
+
+    int memoryBudgetMiB() const;
+    void process(Result& result, QSemaphore* memory) const;
+};
+
+#endif // PAKBATCH_H
@@ -0,0 +1,413 @@
+#include "pakbuffer.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <cstring>
+
+#define SPILL_CHUNK_SIZE (1024 * 1024)
+
+PakBuffer::~PakBuffer()
+{
+}
+
+quint64 PakBuffer::residentSize() const
+{
+    return size();
+}
+
+bool PakBuffer::read(quint64 offset, char* out, quint64 length) const
+{
+    const char* bytes = data();
+
+    if (!bytes || offset > size() || length > size() - offset)
+    {
+        return false;
+    }
+
+    memcpy(out, bytes + offset, length);
+
+    return true;
+}
+
+int PakBuffer::fileHandle(quint64* offset) const
+{
+    Q_UNUSED(offset);
+    return -1;
+}
+
+PakMemoryUsage::PakMemoryUsage()
+{
+    bytes = 0;
+}
+
+void PakMemoryUsage::add(quint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    this->bytes += bytes;
+}
+
+void PakMemoryUsage::remove(quint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    this->bytes -= bytes;
+}
+
+quint64 PakMemoryUsage::total() const
+{
+    QMutexLocker locker(&mutex);
+    return bytes;
+}
+
+PakMemoryBuffer::PakMemoryBuffer(const QByteArray& bytes, const QSharedPointer<PakMemoryUsage>& usage)
+    : bytes(bytes), usage(usage)
+{
+    if (usage)
+    {
+        usage->add(bytes.size());
+    }
+}
+
+PakMemoryBuffer::~PakMemoryBuffer()
+{
+    if (usage)
+    {
+        usage->remove(bytes.size());
+    }
+}
+
+quint64 PakMemoryBuffer::size() const
+{
+    return bytes.size();
+}
+
+const char* PakMemoryBuffer::data() const
+{
+    return bytes.constData();
+}
+
+PakBufferRef PakMemoryBuffer::create(const QByteArray& bytes, const QSharedPointer<PakMemoryUsage>& usage)
+{
+    return PakBufferRef(new PakMemoryBuffer(bytes, usage));
+}
+
+PakMappedBuffer::PakMappedBuffer(const QString& path)
+    : file(path)
+{
+    bytes = nullptr;
+    length = 0;
+    released = false;
+}
+
+quint64 PakMappedBuffer::size() const
+{
+    return length;
+}
+
+quint64 PakMappedBuffer::residentSize() const
+{
+    // Mapped pages are backed by the file and can always be dropped, and a
+    // released buffer is read from files
+    return 0;
+}
+
+const char* PakMappedBuffer::data() const
+{
+    QReadLocker locker(&lock);
+    return released ? nullptr : bytes;
+}
+
+bool PakMappedBuffer::read(quint64 offset, char* out, quint64 length) const
+{
+    QReadLocker locker(&lock);
+
+    if (offset > this->length || length > this->length - offset)
+    {
+        return false;
+    }
+
+    if (!released)
+    {
+        memcpy(out, bytes + offset, length);
+        return true;
+    }
+
+    while (length > 0)
+    {
+        // Last relocation starting at or before offset; together they
+        // cover the whole buffer
+        QVector<Relocation>::const_iterator it = std::upper_bound(
+            relocations.constBegin(), relocations.constEnd(), offset,
+            [](quint64 offset, const Relocation& relocation) { return offset < relocation.offset; });
+
+        if (it == relocations.constBegin())
+        {
+            return false;
+        }
+
+        --it;
+
+        quint64 skip = offset - it->offset;
+        quint64 part = qMin(length, it->length - skip);
+
+        if (skip >= it->length || !it->buffer || !it->buffer->read(it->bufferOffset + skip, out, part))
+        {
+            return false;
+        }
+
+        offset += part;
+        out += part;
+        length -= part;
+    }
+
+    return true;
+}
+
+int PakMappedBuffer::fileHandle(quint64* offset) const
+{
+    Q_UNUSED(offset);
+    return -1;
+}
+
+QString PakMappedBuffer::fileName() const
+{
+    return file.fileName();
+}
+
+PakBufferRef PakMappedBuffer::open(const QString& path)
+{
+    PakMappedBuffer* buffer = new PakMappedBuffer(path);
+
+    if (!buffer->file.open(QFile::ReadOnly) || buffer->file.size() <= 0)
+    {
+        delete buffer;
+        return PakBufferRef();
+    }
+
+    buffer->length = buffer->file.size();
+    buffer->bytes = reinterpret_cast<const char*>(buffer->file.map(0, buffer->length));
+
+    if (!buffer->bytes)
+    {
+        delete buffer;
+        return PakBufferRef();
+    }
+
+    return PakBufferRef(buffer);
+}
+
+bool PakMappedBuffer::beginRelease(const QVector<Range>& kept)
+{
+    QVector<Range> ranges = kept;
+    QVector<Relocation> moved;
+    PakSpillStore store;
+    quint64 position = 0;
+
+    std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.offset < b.offset; });
+
+    // Held until the data can be read again, so readers never see the
+    // mapping go away under them
+    lock.lockForWrite();
+
+    for (const Range& range : ranges)
+    {
+        quint64 end = range.offset + range.length;
+
+        if (end <= position)
+        {
+            continue;
+        }
+
+        // Gaps (tables, padding and data nothing saved still uses) are
+        // copied. Part of a range that overlaps the previous one is
+        // already covered.
+        if (range.offset > position)
+        {
+            Relocation gap;
+            gap.offset = position;
+            gap.length = range.offset - position;
+            gap.bufferOffset = 0;
+
+            if (!file.seek(position) || !(gap.buffer = store.spill(&file, gap.length)))
+            {
+                lock.unlock();
+                return false;
+            }
+
+            moved.append(gap);
+            position = range.offset;
+        }
+
+        Relocation relocation;
+        relocation.offset = position;
+        relocation.length = end - position;
+        relocation.bufferOffset = range.newOffset + (position - range.offset);
+        moved.append(relocation);
+
+        position = end;
+    }
+
+    if (position < length)
+    {
+        Relocation gap;
+        gap.offset = position;
+        gap.length = length - position;
+        gap.bufferOffset = 0;
+
+        if (!file.seek(position) || !(gap.buffer = store.spill(&file, gap.length)))
+        {
+            lock.unlock();
+            return false;
+        }
+
+        moved.append(gap);
+    }
+
+    relocations = moved;
+    released = true;
+    bytes = nullptr;
+    file.close();
+
+    return true;
+}
+
+void PakMappedBuffer::finishRelease(const PakBufferRef& replacement)
+{
+    // Ranges without a buffer are the ones the replacing file holds
+    for (Relocation& relocation : relocations)
+    {
+        if (!relocation.buffer)
+        {
+            relocation.buffer = replacement;
+        }
+    }
+
+    lock.unlock();
+}
+
+void PakMappedBuffer::cancelRelease()
+{
+    // The file wasn't replaced, so it can be mapped again. If even that
+    // fails, reads of the kept ranges fail from now on.
+    if (file.open(QFile::ReadOnly))
+    {
+        bytes = reinterpret_cast<const char*>(file.map(0, length));
+    }
+
+    if (bytes)
+    {
+        released = false;
+        relocations.clear();
+    }
+
+    lock.unlock();
+}
+
+PakFileBuffer::PakFileBuffer(const SourceRef& source, quint64 start, quint64 length)
+    : source(source), start(start), length(length)
+{
+}
+
+quint64 PakFileBuffer::size() const
+{
+    return length;
+}
+
+quint64 PakFileBuffer::residentSize() const
+{
+    return 0;
+}
+
+const char* PakFileBuffer::data() const
+{
+    return nullptr;
+}
+
+bool PakFileBuffer::read(quint64 offset, char* out, quint64 length) const
+{
+    if (offset > this->length || length > this->length - offset)
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&source->mutex);
+
+    return source->file->seek(start + offset) &&
+           source->file->read(out, length) == static_cast<qint64>(length);
+}
+
+int PakFileBuffer::fileHandle(quint64* offset) const
+{
+    QMutexLocker locker(&source->mutex);
+
+    // Spilled data may still be in the QFile write buffer
+    if (!source->file->isOpen() || !source->file->flush())
+    {
+        return -1;
+    }
+
+    *offset = start;
+
+    return source->file->handle();
+}
+
+PakBufferRef PakFileBuffer::open(const QString& path)
+{
+    SourceRef source(new Source);
+    source->file.reset(new QFile(path));
+
+    if (!source->file->open(QFile::ReadOnly))
+    {
+        return PakBufferRef();
+    }
+
+    return PakBufferRef(new PakFileBuffer(source, 0, source->file->size()));
+}
+
+PakSpillStore::PakSpillStore()
+    : source(new PakFileBuffer::Source)
+{
+    end = 0;
+
+    source->file.reset(new QTemporaryFile(QDir::temp().filePath("PakTool-XXXXXX.spill")));
+    source->file->open(QFile::ReadWrite);
+}
+
+PakBufferRef PakSpillStore::spill(QIODevice* device, quint64 length, QCryptographicHash* hash)
+{
+    QMutexLocker locker(&source->mutex);
+
+    if (!source->file->isOpen() || !source->file->seek(end))
+    {
+        return PakBufferRef();
+    }
+
+    QByteArray chunk(SPILL_CHUNK_SIZE, Qt::Uninitialized);
+
+    for (quint64 done = 0; done < length;)
+    {
+        qint64 chunkLength = qMin<quint64>(SPILL_CHUNK_SIZE, length - done);
+
+        if (device->read(chunk.data(), chunkLength) != chunkLength ||
+            source->file->write(chunk.constData(), chunkLength) != chunkLength)
+        {
+            return PakBufferRef();
+        }
+
+        if (hash)
+        {
+            hash->addData(chunk.constData(), chunkLength);
+        }
+
+        done += chunkLength;
+    }
+
+    quint64 start = end;
+    end += length;
+
+    return PakBufferRef(new PakFileBuffer(source, start, length));
+}
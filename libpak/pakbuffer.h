@@ -0,0 +1,184 @@
+#ifndef PAKBUFFER_H
+#define PAKBUFFER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QVector>
+
+class QCryptographicHash;
+
+// Immutable block of bytes shared between resources. Resources hold a
+// reference plus an offset/size slice, so copying a resource (or a whole
+// PakFile) never copies data. Buffers are never written after creation,
+// which makes it safe to read them from several threads at once.
+class PakBuffer
+{
+public:
+    virtual ~PakBuffer();
+
+    virtual quint64 size() const = 0;
+
+    // Bytes of memory the buffer keeps allocated
+    virtual quint64 residentSize() const;
+
+    // Pointer to the buffer contents, or nullptr if the buffer is not
+    // resident in memory. Use read() when the data may not be resident.
+    virtual const char* data() const = 0;
+
+    virtual bool read(quint64 offset, char* out, quint64 length) const;
+
+    // Handle of the open file the data is stored in, for positioned reads
+    // that bypass read(), with the position of the data in it; -1 when the
+    // buffer isn't backed by an open file
+    virtual int fileHandle(quint64* offset) const;
+};
+
+typedef QSharedPointer<const PakBuffer> PakBufferRef;
+
+// Running total of the memory held by buffers created against it. Buffers
+// count until they are destroyed, so the total includes data that only
+// copies of an archive (undo snapshots) still hold.
+class PakMemoryUsage
+{
+public:
+    PakMemoryUsage();
+
+    void add(quint64 bytes);
+    void remove(quint64 bytes);
+    quint64 total() const;
+
+private:
+    mutable QMutex mutex;
+    quint64 bytes;
+};
+
+class PakMemoryBuffer : public PakBuffer
+{
+public:
+    explicit PakMemoryBuffer(const QByteArray& bytes,
+                             const QSharedPointer<PakMemoryUsage>& usage = QSharedPointer<PakMemoryUsage>());
+    ~PakMemoryBuffer() override;
+
+    quint64 size() const override;
+    const char* data() const override;
+
+    static PakBufferRef create(const QByteArray& bytes,
+                               const QSharedPointer<PakMemoryUsage>& usage = QSharedPointer<PakMemoryUsage>());
+
+private:
+    QByteArray bytes;
+    QSharedPointer<PakMemoryUsage> usage;
+};
+
+// Read-only mapping of a whole file. Pages are only loaded from disk when
+// they are touched, so opening and browsing a large archive costs little
+// more than its table.
+//
+// Windows can't replace a mapped file, so saving an archive over the file
+// it is mapped from releases the mapping first. The data then moves: the
+// ranges the saved archive still holds are read from the new file, and
+// everything else from a temporary copy. read() is safe throughout (it
+// waits while the data moves), but pointers from data() become invalid.
+class PakMappedBuffer : public PakBuffer
+{
+public:
+    // A range of the buffer written to newOffset of the replacing file
+    struct Range
+    {
+        quint64 offset;
+        quint64 length;
+        quint64 newOffset;
+    };
+
+    quint64 size() const override;
+    quint64 residentSize() const override;
+    const char* data() const override;
+    bool read(quint64 offset, char* out, quint64 length) const override;
+    int fileHandle(quint64* offset) const override;
+
+    QString fileName() const;
+
+    // Returns a null reference if the file can't be opened or mapped
+    static PakBufferRef open(const QString& path);
+
+    // Copies what lies outside the kept ranges to a temporary file, then
+    // unmaps and closes the file. Reads wait until finishRelease() gives
+    // the replacing file, or cancelRelease() maps the file again.
+    bool beginRelease(const QVector<Range>& kept);
+    void finishRelease(const PakBufferRef& replacement);
+    void cancelRelease();
+
+private:
+    struct Relocation
+    {
+        quint64 offset;
+        quint64 length;
+        PakBufferRef buffer;
+        quint64 bufferOffset;
+    };
+
+    PakMappedBuffer(const QString& path);
+
+    mutable QReadWriteLock lock;
+    QFile file;
+    const char* bytes;
+    quint64 length;
+
+    // Where the data is read from once released, sorted by offset
+    bool released;
+    QVector<Relocation> relocations;
+};
+
+// Stretch of a file that is read on demand with positioned reads, for data
+// that should not stay in memory. Buffers can share one open file; reads
+// on it are serialized.
+class PakFileBuffer : public PakBuffer
+{
+public:
+    struct Source
+    {
+        QMutex mutex;
+        QScopedPointer<QFile> file;
+    };
+
+    typedef QSharedPointer<Source> SourceRef;
+
+    PakFileBuffer(const SourceRef& source, quint64 start, quint64 length);
+
+    quint64 size() const override;
+    quint64 residentSize() const override;
+    const char* data() const override;
+    bool read(quint64 offset, char* out, quint64 length) const override;
+    int fileHandle(quint64* offset) const override;
+
+    // Returns a null reference if the file can't be opened
+    static PakBufferRef open(const QString& path);
+
+private:
+    SourceRef source;
+    quint64 start;
+    quint64 length;
+};
+
+// Temporary file that imported data is copied to when it doesn't fit in
+// the memory budget. The file is removed once the store and every buffer
+// spilled to it are gone.
+class PakSpillStore
+{
+public:
+    PakSpillStore();
+
+    // Appends length bytes from device to the store in small chunks,
+    // feeding them to hash if given. Returns a null reference on failure.
+    PakBufferRef spill(QIODevice* device, quint64 length, QCryptographicHash* hash = nullptr);
+
+private:
+    PakFileBuffer::SourceRef source;
+    quint64 end;
+};
+
+#endif // PAKBUFFER_H
@@ -0,0 +1,354 @@
+#include "pakbuilder.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QScopedPointer>
+
+#define BUILD_RECORD_VERSION 1
+
+static bool isPowerOfTwo(quint32 value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+static qint64 modifiedTime(const QFileInfo& fileInfo)
+{
+    return fileInfo.lastModified().toMSecsSinceEpoch();
+}
+
+PakBuilder::PakBuilder()
+{
+    force = false;
+    memoryBudget = PakFile().memoryBudget;
+}
+
+bool PakBuilder::loadManifest(const QString& path)
+{
+    QFile file(path);
+
+    if (!file.open(QFile::ReadOnly))
+    {
+        errorString = QString("Could not open manifest %1.").arg(path);
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+
+    file.close();
+
+    if (!document.isObject())
+    {
+        errorString = QString("Could not parse manifest %1: %2.").arg(path, parseError.errorString());
+        return false;
+    }
+
+    manifestPath = path;
+    archives.clear();
+
+    QJsonArray archiveArray = document.object().value("archives").toArray();
+
+    for (const QJsonValue& archiveValue : archiveArray)
+    {
+        QJsonObject archiveObject = archiveValue.toObject();
+        Archive archive;
+
+        archive.output = archiveObject.value("output").toString();
+        archive.sectorSize = archiveObject.value("sectorSize").toInt(2048);
+        archive.sizeAlign = archiveObject.value("sizeAlign").toInt(64);
+
+        QString endian = archiveObject.value("endian").toString("big");
+
+        if (archive.output.isEmpty())
+        {
+            errorString = "Manifest archive has no output.";
+            return false;
+        }
+
+        if (endian == "big")
+        {
+            archive.endian = PakFile::PAKFILE_BIG_ENDIAN;
+        }
+        else if (endian == "little")
+        {
+            archive.endian = PakFile::PAKFILE_LITTLE_ENDIAN;
+        }
+        else
+        {
+            errorString = QString("%1: unknown endian \"%2\".").arg(archive.output, endian);
+            return false;
+        }
+
+        if (!isPowerOfTwo(archive.sectorSize) || !isPowerOfTwo(archive.sizeAlign))
+        {
+            errorString = QString("%1: sectorSize and sizeAlign must be powers of two.").arg(archive.output);
+            return false;
+        }
+
+        for (const QJsonValue& resourceValue : archiveObject.value("resources").toArray())
+        {
+            Entry entry;
+
+            if (resourceValue.isString())
+            {
+                entry.source = resourceValue.toString();
+                entry.name = QFileInfo(entry.source).fileName();
+            }
+            else
+            {
+                QJsonObject resourceObject = resourceValue.toObject();
+
+                entry.source = resourceObject.value("source").toString();
+                entry.name = resourceObject.value("name").toString(QFileInfo(entry.source).fileName());
+            }
+
+            if (entry.source.isEmpty() || entry.name.isEmpty())
+            {
+                errorString = QString("%1: resource without a source.").arg(archive.output);
+                return false;
+            }
+
+            archive.entries.append(entry);
+        }
+
+        archives.append(archive);
+    }
+
+    return true;
+}
+
+bool PakBuilder::build(QTextStream& log)
+{
+    bool success = true;
+
+    for (const Archive& archive : archives)
+    {
+        if (!buildArchive(archive, log))
+        {
+            log << archive.output << ": " << errorString << "\n";
+            success = false;
+        }
+    }
+
+    log.flush();
+
+    return success;
+}
+
+bool PakBuilder::buildArchive(const Archive& archive, QTextStream& log)
+{
+    QString outputPath = resolve(archive.output);
+    QString recordPath = outputPath + ".build.json";
+    QFileInfo outputInfo(outputPath);
+
+    // The previous record is only trusted if the output it describes is
+    // still exactly what was written.
+    QVector<SourceRecord> previous;
+    QHash<QString, int> previousBySource;
+    bool hasRecord = false;
+    bool settingsMatch = false;
+
+    QFile recordFile(recordPath);
+
+    if (!force && outputInfo.exists() && recordFile.open(QFile::ReadOnly))
+    {
+        QJsonObject root = QJsonDocument::fromJson(recordFile.readAll()).object();
+
+        recordFile.close();
+
+        hasRecord = root.value("version").toInt() == BUILD_RECORD_VERSION &&
+                    root.value("outputSize").toVariant().toLongLong() == outputInfo.size() &&
+                    root.value("outputModified").toVariant().toLongLong() == modifiedTime(outputInfo);
+
+        settingsMatch = root.value("endian").toInt() == archive.endian &&
+                        static_cast<quint32>(root.value("sectorSize").toInt()) == archive.sectorSize &&
+                        static_cast<quint32>(root.value("sizeAlign").toInt()) == archive.sizeAlign;
+
+        for (const QJsonValue& value : root.value("resources").toArray())
+        {
+            QJsonObject object = value.toObject();
+            SourceRecord record;
+
+            record.name = object.value("name").toString();
+            record.source = object.value("source").toString();
+            record.size = object.value("size").toVariant().toLongLong();
+            record.modified = object.value("modified").toVariant().toLongLong();
+            record.hash = QByteArray::fromHex(object.value("hash").toString().toLatin1());
+
+            previousBySource.insert(record.source, previous.count());
+            previous.append(record);
+        }
+    }
+
+    // Stat every source and work out which ones are unchanged. A source
+    // whose time stamp moved but whose size did not is hashed, so touching
+    // a file doesn't force a rebuild.
+    QVector<SourceRecord> current(archive.entries.count());
+    QVector<int> reuseIndex(archive.entries.count(), -1);
+    bool upToDate = hasRecord && settingsMatch && previous.count() == archive.entries.count();
+
+    for (int i = 0; i < archive.entries.count(); i++)
+    {
+        const Entry& entry = archive.entries[i];
+        QFileInfo sourceInfo(resolve(entry.source));
+
+        if (!sourceInfo.isFile())
+        {
+            errorString = QString("Source %1 does not exist.").arg(entry.source);
+            return false;
+        }
+
+        SourceRecord& record = current[i];
+        record.name = entry.name;
+        record.source = entry.source;
+        record.size = sourceInfo.size();
+        record.modified = modifiedTime(sourceInfo);
+
+        int prevIndex = hasRecord ? previousBySource.value(entry.source, -1) : -1;
+        bool unchanged = false;
+
+        if (prevIndex >= 0 && previous[prevIndex].size == record.size)
+        {
+            if (previous[prevIndex].modified == record.modified)
+            {
+                unchanged = true;
+                record.hash = previous[prevIndex].hash;
+            }
+            else
+            {
+                QFile sourceFile(sourceInfo.filePath());
+                QCryptographicHash sha1(QCryptographicHash::Sha1);
+
+                if (!sourceFile.open(QFile::ReadOnly) || !sha1.addData(&sourceFile))
+                {
+                    errorString = QString("Could not read source %1.").arg(entry.source);
+                    return false;
+                }
+
+                sourceFile.close();
+
+                record.hash = sha1.result();
+                unchanged = record.hash == previous[prevIndex].hash;
+            }
+        }
+
+        if (unchanged)
+        {
+            reuseIndex[i] = prevIndex;
+        }
+
+        if (!unchanged || prevIndex != i || previous[i].name != entry.name)
+        {
+            upToDate = false;
+        }
+    }
+
+    if (upToDate)
+    {
+        log << archive.output << ": up to date\n";
+        return true;
+    }
+
+    QString previousPath = outputPath;
+    QScopedPointer<PakFile> previousPak(hasRecord ? PakFile::open(previousPath) : nullptr);
+
+    if (previousPak && previousPak->resources.count() != previous.count())
+    {
+        previousPak.reset();
+    }
+
+    PakFile pakFile;
+    pakFile.memoryBudget = memoryBudget;
+    pakFile.path = outputPath;
+    pakFile.endian = archive.endian;
+    pakFile.sectorSize = archive.sectorSize;
+    pakFile.sizeAlign = archive.sizeAlign;
+
+    int reused = 0;
+    int read = 0;
+
+    for (int i = 0; i < archive.entries.count(); i++)
+    {
+        SourceRecord& record = current[i];
+        PakFile::Resource resource;
+
+        if (previousPak && reuseIndex[i] >= 0 &&
+            previousPak->resources[reuseIndex[i]].size == record.size)
+        {
+            resource = previousPak->resources[reuseIndex[i]];
+            reused++;
+        }
+        else
+        {
+            if (!pakFile.loadResource(resource, resolve(record.source), &record.hash) ||
+                resource.size != record.size)
+            {
+                errorString = QString("Could not read source %1.").arg(record.source);
+                return false;
+            }
+
+            read++;
+        }
+
+        resource.name = record.name;
+        pakFile.resources.append(resource);
+    }
+
+    QDir().mkpath(QFileInfo(outputPath).absolutePath());
+
+    if (!pakFile.save())
+    {
+        errorString = QString("Could not write %1.").arg(archive.output);
+        return false;
+    }
+
+    previousPak.reset();
+    outputInfo.refresh();
+
+    QJsonArray resourceArray;
+
+    for (const SourceRecord& record : current)
+    {
+        QJsonObject object;
+        object.insert("name", record.name);
+        object.insert("source", record.source);
+        object.insert("size", record.size);
+        object.insert("modified", record.modified);
+        object.insert("hash", QString::fromLatin1(record.hash.toHex()));
+        resourceArray.append(object);
+    }
+
+    QJsonObject root;
+    root.insert("version", BUILD_RECORD_VERSION);
+    root.insert("endian", static_cast<int>(archive.endian));
+    root.insert("sectorSize", static_cast<qint64>(archive.sectorSize));
+    root.insert("sizeAlign", static_cast<qint64>(archive.sizeAlign));
+    root.insert("outputSize", outputInfo.size());
+    root.insert("outputModified", modifiedTime(outputInfo));
+    root.insert("resources", resourceArray);
+
+    if (!recordFile.open(QFile::WriteOnly) ||
+        recordFile.write(QJsonDocument(root).toJson()) < 0)
+    {
+        errorString = QString("Could not write build record %1.").arg(recordPath);
+        return false;
+    }
+
+    recordFile.close();
+
+    log << archive.output << ": built (" << read << " read, " << reused << " reused)\n";
+
+    return true;
+}
+
+QString PakBuilder::resolve(const QString& path) const
+{
+    return QFileInfo(manifestPath).dir().filePath(path);
+}
@@ -0,0 +1,79 @@
+#ifndef PAKBUILDER_H
+#define PAKBUILDER_H
+
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+
+#include "pakfile.h"
+
+// Builds PAK files from a JSON manifest:
+//
+// {
+//     "archives": [
+//         {
+//             "output": "out/level1.pak",
+//             "endian": "big",
+//             "sectorSize": 2048,
+//             "sizeAlign": 64,
+//             "resources": [
+//                 "src/intro.bik",
+//                 { "name": "level1.hip", "source": "src/level1/level1.hip" }
+//             ]
+//         }
+//     ]
+// }
+//
+// Paths are relative to the manifest. Next to each output a build record
+// (<output>.build.json) stores the settings and the size, modification time
+// and hash of every source. Archives whose record still matches are
+// skipped; otherwise unchanged resources are copied out of the previous
+// output instead of being read from their sources again. Output only
+// depends on the manifest and the source contents, so it is reproducible.
+// Sources that don't fit in memoryBudget are staged in a temporary file.
+class PakBuilder
+{
+public:
+    struct Entry
+    {
+        QString name;
+        QString source;
+    };
+
+    struct Archive
+    {
+        QString output;
+        PakFile::Endian endian;
+        quint32 sectorSize;
+        quint32 sizeAlign;
+        QVector<Entry> entries;
+    };
+
+    PakBuilder();
+
+    bool loadManifest(const QString& path);
+
+    // Builds every archive in the manifest. Returns false if any failed.
+    bool build(QTextStream& log);
+
+    bool force;
+    quint64 memoryBudget;
+    QString manifestPath;
+    QVector<Archive> archives;
+    QString errorString;
+
+private:
+    struct SourceRecord
+    {
+        QString name;
+        QString source;
+        qint64 size;
+        qint64 modified;
+        QByteArray hash;
+    };
+
+    bool buildArchive(const Archive& archive, QTextStream& log);
+    QString resolve(const QString& path) const;
+};
+
+#endif // PAKBUILDER_H
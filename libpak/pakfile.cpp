@@ -0,0 +1,722 @@
+#include "pakfile.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QtEndian>
+
+struct PakHeader
+{
+    quint32 magic;
+    quint32 endian;
+    quint32 dataOffset;
+    quint32 pakSize;
+    quint32 nameOffset;
+    quint32 resCount;
+};
+
+struct PakResource
+{
+    quint32 nameOffset;
+    quint32 dataOffset;
+    quint32 dataSize;
+};
+
+#define align(val, alignment) (((val) + (alignment) - 1) & -(alignment))
+
+// Largest resource kept in a QByteArray
+#define MAX_MEMORY_RESOURCE_SIZE (1024 * 1024 * 1024)
+
+PakFile::PakFile()
+{
+    endian = PAKFILE_BIG_ENDIAN;
+    unsaved = true;
+    sectorSize = 2048;
+    sizeAlign = 64;
+    memoryBudget = 512 * 1024 * 1024;
+    memoryUsage.reset(new PakMemoryUsage);
+}
+
+PakFile* PakFile::open(QString &path)
+{
+    // Map the archive so resource data is only paged in when it is used,
+    // falling back to positioned reads when the file can't be mapped.
+    PakBufferRef pakData = PakMappedBuffer::open(path);
+
+    if (!pakData)
+    {
+        pakData = PakFileBuffer::open(path);
+
+        if (!pakData)
+        {
+            return nullptr;
+        }
+    }
+
+    Endian endian;
+    QVector<TableEntry> table;
+
+    if (!readTable(*pakData, &endian, &table))
+    {
+        return nullptr;
+    }
+
+    PakFile* pakFile = new PakFile;
+    pakFile->path = path;
+    pakFile->unsaved = false;
+    pakFile->endian = endian;
+    pakFile->data = pakData;
+
+    pakFile->resources.reserve(table.count());
+
+    for (const TableEntry& entry : table)
+    {
+        Resource resource;
+
+        resource.name = entry.name;
+        resource.buffer = pakFile->data;
+        resource.offset = entry.offset;
+        resource.size = entry.size;
+
+        pakFile->resources.append(resource);
+    }
+
+    return pakFile;
+}
+
+quint32 PakFile::alignmentOf(quint64 value, quint32 limit)
+{
+    quint32 alignment = 1;
+
+    while (alignment < limit && value % (static_cast<quint64>(alignment) * 2) == 0)
+    {
+        alignment *= 2;
+    }
+
+    return alignment;
+}
+
+bool PakFile::isUnchangedOnDisk() const
+{
+    if (!data || unsaved)
+    {
+        return false;
+    }
+
+    for (const Resource& resource : resources)
+    {
+        if (resource.buffer != data)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PakFile::inferAlignment(quint32* sectorSize, quint32* sizeAlign) const
+{
+    *sizeAlign = alignmentOf(data->size(), *sizeAlign);
+
+    for (const Resource& resource : resources)
+    {
+        *sectorSize = alignmentOf(resource.offset, *sectorSize);
+    }
+}
+
+void PakFile::keepDiskAlignment()
+{
+    if (isUnchangedOnDisk())
+    {
+        inferAlignment(&sectorSize, &sizeAlign);
+    }
+}
+
+bool PakFile::readTable(const PakBuffer& pakData, Endian* endian, QVector<TableEntry>* table, QStringList* errors)
+{
+    // Unmapped archives only have their header and tables read
+    const char* tableBytes = pakData.data();
+    QByteArray tableData;
+
+    if (!tableBytes)
+    {
+        tableData.resize(qMin<quint64>(HEADER_SIZE, pakData.size()));
+
+        if (!pakData.read(0, tableData.data(), tableData.size()))
+        {
+            if (errors)
+            {
+                errors->append("Could not read the header.");
+            }
+
+            return false;
+        }
+
+        if (tableData.size() == static_cast<int>(HEADER_SIZE))
+        {
+            quint64 size = qMin<quint64>(tableSize(tableData.constData()), pakData.size());
+
+            tableData.resize(qMax<quint64>(size, HEADER_SIZE));
+
+            if (!pakData.read(0, tableData.data(), tableData.size()))
+            {
+                if (errors)
+                {
+                    errors->append("Could not read the resource table.");
+                }
+
+                return false;
+            }
+        }
+
+        tableBytes = tableData.constData();
+    }
+
+    return readTable(tableBytes, pakData.size(), endian, table, errors);
+}
+
+quint32 PakFile::tableSize(const char* header)
+{
+    PakHeader pakHeader;
+    memcpy(&pakHeader, header, sizeof(PakHeader));
+
+    if (pakHeader.endian == 0)
+    {
+        return qFromBigEndian<quint32>(pakHeader.dataOffset);
+    }
+
+    return qFromLittleEndian<quint32>(pakHeader.dataOffset);
+}
+
+bool PakFile::readTable(const char* pakData, quint64 pakSize, Endian* endian,
+                        QVector<TableEntry>* table, QStringList* errors)
+{
+    Q_STATIC_ASSERT(sizeof(PakHeader) == HEADER_SIZE);
+
+    if (pakSize < sizeof(PakHeader))
+    {
+        if (errors)
+        {
+            errors->append("File is too small to hold a PAK header.");
+        }
+
+        return false;
+    }
+
+    PakHeader pakHeader;
+    memcpy(&pakHeader, pakData, sizeof(PakHeader));
+
+    if (pakHeader.magic != 'pack' && pakHeader.magic != 'kcap')
+    {
+        if (errors)
+        {
+            errors->append("Bad magic, not a PAK file.");
+        }
+
+        return false;
+    }
+
+    if (pakHeader.endian == 0)
+    {
+        *endian = PAKFILE_BIG_ENDIAN;
+        qFromBigEndian<quint32>(&pakHeader, 6, &pakHeader);
+    }
+    else
+    {
+        *endian = PAKFILE_LITTLE_ENDIAN;
+        qFromLittleEndian<quint32>(&pakHeader, 6, &pakHeader);
+    }
+
+    quint64 tableEnd = sizeof(PakHeader) + static_cast<quint64>(sizeof(PakResource)) * pakHeader.resCount;
+
+    if (tableEnd > pakHeader.nameOffset || pakHeader.nameOffset > pakHeader.dataOffset ||
+        pakHeader.dataOffset > pakHeader.pakSize)
+    {
+        if (errors)
+        {
+            errors->append(QString("Header offsets are inconsistent (%1 resources, names at %2, data at %3, size %4).")
+                           .arg(pakHeader.resCount).arg(pakHeader.nameOffset)
+                           .arg(pakHeader.dataOffset).arg(pakHeader.pakSize));
+        }
+
+        return false;
+    }
+
+    if (pakHeader.pakSize > pakSize)
+    {
+        if (errors)
+        {
+            errors->append(QString("File is truncated (header size %1, file size %2).")
+                           .arg(pakHeader.pakSize).arg(pakSize));
+        }
+
+        return false;
+    }
+
+    const char* nameTable = pakData + pakHeader.nameOffset;
+    quint32 nameTableSize = pakHeader.dataOffset - pakHeader.nameOffset;
+    bool valid = true;
+
+    table->resize(pakHeader.resCount);
+
+    for (quint32 i = 0; i < pakHeader.resCount; i++)
+    {
+        PakResource pakResource;
+        memcpy(&pakResource, pakData + sizeof(PakHeader) + sizeof(PakResource) * i, sizeof(PakResource));
+
+        if (*endian == PAKFILE_BIG_ENDIAN)
+        {
+            qFromBigEndian<quint32>(&pakResource, 3, &pakResource);
+        }
+        else
+        {
+            qFromLittleEndian<quint32>(&pakResource, 3, &pakResource);
+        }
+
+        TableEntry& entry = (*table)[i];
+        entry.offset = pakResource.dataOffset;
+        entry.size = pakResource.dataSize;
+
+        const char* name = nameTable + pakResource.nameOffset;
+
+        if (pakResource.nameOffset >= nameTableSize ||
+            !memchr(name, '\0', nameTableSize - pakResource.nameOffset))
+        {
+            if (errors)
+            {
+                errors->append(QString("Resource %1 has a name outside of the name table.").arg(i));
+            }
+
+            valid = false;
+            continue;
+        }
+
+        entry.name = decodeName(name);
+
+        if (entry.offset < pakHeader.dataOffset ||
+            static_cast<quint64>(entry.offset) + entry.size > pakHeader.pakSize)
+        {
+            if (errors)
+            {
+                errors->append(QString("Resource %1 (%2) lies outside of the data area.").arg(i).arg(entry.name));
+            }
+
+            valid = false;
+        }
+    }
+
+    return valid;
+}
+
+PakFile::Layout PakFile::layout() const
+{
+    Layout layout;
+    quint32 resCount = resources.count();
+
+    layout.nameOffset = sizeof(PakHeader) + static_cast<quint64>(sizeof(PakResource)) * resCount;
+    layout.dataOffset = layout.nameOffset;
+
+    for (quint32 i = 0; i < resCount; i++)
+    {
+        layout.dataOffset += encodeName(resources[i].name).size() + 1;
+    }
+
+    layout.pakSize = layout.dataOffset;
+    layout.dataOffsets.resize(resCount);
+
+    for (quint32 i = 0; i < resCount; i++)
+    {
+        layout.pakSize = align(layout.pakSize, static_cast<quint64>(sectorSize));
+        layout.dataOffsets[i] = layout.pakSize;
+        layout.pakSize += resources[i].size;
+    }
+
+    layout.pakSize = align(layout.pakSize, static_cast<quint64>(sizeAlign));
+
+    return layout;
+}
+
+QByteArray PakFile::encodeName(const QString& name)
+{
+    return name.toUtf8();
+}
+
+QString PakFile::decodeName(const char* name)
+{
+    return QString::fromUtf8(name);
+}
+
+bool PakFile::save()
+{
+    Layout layout = this->layout();
+    quint32 resCount = resources.count();
+
+    if (layout.pakSize > 0xFFFFFFFF)
+    {
+        return false;
+    }
+
+    // Header, table and names are built in memory; resource data is then
+    // streamed to the file through PakIo straight from where it is, so
+    // saving never needs more memory than the tables plus copy buffers.
+    QByteArray tableData(static_cast<int>(layout.dataOffset), '\0');
+
+    PakHeader* pakHeader = reinterpret_cast<PakHeader*>(tableData.data());
+    PakResource* pakResources = reinterpret_cast<PakResource*>(pakHeader + 1);
+
+    pakHeader->magic = 'pack';
+    pakHeader->endian = endian;
+    pakHeader->dataOffset = layout.dataOffset;
+    pakHeader->pakSize = layout.pakSize;
+    pakHeader->nameOffset = layout.nameOffset;
+    pakHeader->resCount = resCount;
+
+    quint32 nameOffset = 0;
+
+    for (quint32 i = 0; i < resCount; i++)
+    {
+        QByteArray name = encodeName(resources[i].name);
+
+        PakResource* pakResource = &pakResources[i];
+        pakResource->nameOffset = nameOffset;
+        pakResource->dataOffset = layout.dataOffsets[i];
+        pakResource->dataSize = resources[i].size;
+
+        memcpy(tableData.data() + layout.nameOffset + nameOffset, name.constData(), name.size() + 1);
+
+        nameOffset += name.size() + 1;
+    }
+
+    if (endian == PAKFILE_BIG_ENDIAN)
+    {
+        qToBigEndian<quint32>(pakHeader, 6, pakHeader);
+        qToBigEndian<quint32>(pakResources, 3 * resCount, pakResources);
+    }
+    else
+    {
+        qToLittleEndian<quint32>(pakHeader, 6, pakHeader);
+        qToLittleEndian<quint32>(pakResources, 3 * resCount, pakResources);
+    }
+
+    // Write to a temporary file that replaces the archive at the end. The
+    // old archive may still be mapped (by this file or by snapshots of it),
+    // so it must be replaced rather than truncated and overwritten.
+    QSaveFile file(path);
+
+    if (!file.open(QFile::WriteOnly))
+    {
+        return false;
+    }
+
+    // Padding is zero-filled so output is deterministic
+    QVector<PakIo::Write> writes;
+    PakIo::Write tableWrite;
+
+    tableWrite.data = tableData.constData();
+    tableWrite.length = tableData.size();
+    writes.reserve(resCount + 1);
+    writes.append(tableWrite);
+
+    for (quint32 i = 0; i < resCount; i++)
+    {
+        writes.append(resources[i].writeRequest(layout.dataOffsets[i]));
+    }
+
+    if (!PakIo::instance()->write(&file, writes, layout.pakSize))
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    // Windows can't replace a mapped file, so this archive's own mapping is
+    // released first; any other mapping of it makes the commit fail. Undo
+    // snapshots and other copies of this PakFile keep reading the buffer:
+    // what the new file holds is read from there, and only data it no
+    // longer holds is copied.
+    PakMappedBuffer* released = nullptr;
+
+#ifdef Q_OS_WIN
+    const PakMappedBuffer* mapped = dynamic_cast<const PakMappedBuffer*>(data.data());
+
+    if (mapped && QFileInfo(mapped->fileName()).canonicalFilePath() == QFileInfo(path).canonicalFilePath())
+    {
+        QVector<PakMappedBuffer::Range> kept;
+
+        for (quint32 i = 0; i < resCount; i++)
+        {
+            if (resources[i].buffer == data)
+            {
+                PakMappedBuffer::Range range;
+                range.offset = resources[i].offset;
+                range.length = resources[i].size;
+                range.newOffset = layout.dataOffsets[i];
+                kept.append(range);
+            }
+        }
+
+        released = const_cast<PakMappedBuffer*>(mapped);
+
+        if (!released->beginRelease(kept))
+        {
+            file.cancelWriting();
+            return false;
+        }
+    }
+#endif
+
+    if (!file.commit())
+    {
+        if (released)
+        {
+            released->cancelRelease();
+        }
+
+        return false;
+    }
+
+    // Rebind every resource to the freshly written archive so imported and
+    // spilled data is released once nothing else (e.g. an undo snapshot)
+    // references it.
+    data = PakMappedBuffer::open(path);
+
+    if (!data)
+    {
+        data = PakFileBuffer::open(path);
+    }
+
+    if (released)
+    {
+        released->finishRelease(data);
+    }
+
+    if (data)
+    {
+        for (quint32 i = 0; i < resCount; i++)
+        {
+            resources[i].buffer = data;
+            resources[i].offset = layout.dataOffsets[i];
+        }
+
+        spillStore.reset();
+    }
+
+    unsaved = false;
+    return true;
+}
+
+PakFile* PakFile::merge(const QVector<const PakFile*>& pakFiles, MergePolicy policy, QString* conflict)
+{
+    PakFile* merged = new PakFile;
+    QHash<QString, int> indices;
+
+    if (!pakFiles.empty())
+    {
+        merged->endian = pakFiles.first()->endian;
+        merged->sectorSize = pakFiles.first()->sectorSize;
+        merged->sizeAlign = pakFiles.first()->sizeAlign;
+    }
+
+    for (const PakFile* pakFile : pakFiles)
+    {
+        for (const Resource& resource : pakFile->resources)
+        {
+            QHash<QString, int>::const_iterator it = indices.constFind(resource.name);
+
+            if (it == indices.constEnd())
+            {
+                indices.insert(resource.name, merged->resources.count());
+                merged->resources.append(resource);
+            }
+            else if (policy == PAKFILE_MERGE_LAST_WINS)
+            {
+                merged->resources[it.value()] = resource;
+            }
+            else if (policy == PAKFILE_MERGE_ERROR)
+            {
+                if (conflict)
+                {
+                    *conflict = resource.name;
+                }
+
+                delete merged;
+                return nullptr;
+            }
+        }
+    }
+
+    return merged;
+}
+
+QVector<PakFile> PakFile::split(quint64 budget) const
+{
+    QVector<PakFile> parts;
+
+    // Running size of the current part: every resource starts on a sector
+    // boundary after the tables, so only the table size and the padded
+    // sizes of all but the last resource are needed.
+    quint64 tableEnd = 0;
+    quint64 paddedData = 0;
+
+    for (const Resource& resource : resources)
+    {
+        quint64 nameLength = encodeName(resource.name).size() + 1;
+
+        if (!parts.empty() && !parts.last().resources.empty())
+        {
+            quint64 newTableEnd = tableEnd + sizeof(PakResource) + nameLength;
+            quint64 newSize = align(align(newTableEnd, static_cast<quint64>(sectorSize)) + paddedData + resource.size,
+                                    static_cast<quint64>(sizeAlign));
+
+            if (newSize <= budget)
+            {
+                parts.last().resources.append(resource);
+                tableEnd = newTableEnd;
+                paddedData += align(static_cast<quint64>(resource.size), static_cast<quint64>(sectorSize));
+                continue;
+            }
+        }
+
+        PakFile part;
+        part.endian = endian;
+        part.sectorSize = sectorSize;
+        part.sizeAlign = sizeAlign;
+        part.memoryBudget = memoryBudget;
+        part.resources.append(resource);
+        parts.append(part);
+
+        tableEnd = sizeof(PakHeader) + sizeof(PakResource) + nameLength;
+        paddedData = align(static_cast<quint64>(resource.size), static_cast<quint64>(sectorSize));
+    }
+
+    return parts;
+}
+
+bool PakFile::loadResource(Resource& resource, const QString& path, QByteArray* hash)
+{
+    QFile file(path);
+
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    qint64 size = file.size();
+
+    if (size > 0xFFFFFFFF)
+    {
+        return false;
+    }
+
+    PakBufferRef buffer;
+
+    // Files QByteArray can't hold are always spilled, whatever the budget
+    if (size <= MAX_MEMORY_RESOURCE_SIZE && static_cast<quint64>(size) + residentSize() <= memoryBudget)
+    {
+        QByteArray bytes(static_cast<int>(size), Qt::Uninitialized);
+        PakIo::Read read;
+
+        read.offset = 0;
+        read.data = bytes.data();
+        read.length = size;
+
+        if (!PakIo::instance()->read(&file, QVector<PakIo::Read>() << read))
+        {
+            return false;
+        }
+
+        if (hash)
+        {
+            *hash = QCryptographicHash::hash(bytes, QCryptographicHash::Sha1);
+        }
+
+        buffer = PakMemoryBuffer::create(bytes, memoryUsage);
+    }
+    else
+    {
+        // Over budget: copy the file to the spill store without ever
+        // holding all of it in memory
+        QCryptographicHash sha1(QCryptographicHash::Sha1);
+
+        if (!spillStore)
+        {
+            spillStore.reset(new PakSpillStore);
+        }
+
+        buffer = spillStore->spill(&file, size, hash ? &sha1 : nullptr);
+
+        if (!buffer)
+        {
+            return false;
+        }
+
+        if (hash)
+        {
+            *hash = sha1.result();
+        }
+    }
+
+    file.close();
+
+    resource.name = QFileInfo(path).fileName();
+    resource.buffer = buffer;
+    resource.offset = 0;
+    resource.size = size;
+
+    return true;
+}
+
+quint64 PakFile::residentSize() const
+{
+    return memoryUsage->total();
+}
+
+void PakFile::deleteResource(int index)
+{
+    resources.remove(index);
+}
+
+PakFile::Resource::Resource()
+{
+    offset = 0;
+    size = 0;
+}
+
+const char* PakFile::Resource::data() const
+{
+    if (!buffer || !buffer->data())
+    {
+        return nullptr;
+    }
+
+    return buffer->data() + offset;
+}
+
+PakIo::Write PakFile::Resource::writeRequest(quint64 offset) const
+{
+    PakIo::Write write;
+
+    write.offset = offset;
+    write.length = size;
+    write.data = data();
+    write.buffer = buffer;
+    write.bufferOffset = this->offset;
+
+    return write;
+}
+
+bool PakFile::Resource::read(quint32 pos, char* out, quint32 length) const
+{
+    if (pos > size || length > size - pos)
+    {
+        return false;
+    }
+
+    if (length == 0)
+    {
+        return true;
+    }
+
+    return buffer && buffer->read(static_cast<quint64>(offset) + pos, out, length);
+}
@@ -0,0 +1,153 @@
+#ifndef PAKFILE_H
+#define PAKFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "pakbuffer.h"
+#include "pakio.h"
+
+// PakFile and its resources only hold references to immutable buffers, so
+// copying a PakFile is a cheap snapshot (O(resources), no data is copied).
+class PakFile
+{
+public:
+    enum Endian
+    {
+        PAKFILE_BIG_ENDIAN = 0,
+        PAKFILE_LITTLE_ENDIAN = 1
+    };
+
+    enum MergePolicy
+    {
+        PAKFILE_MERGE_FIRST_WINS = 0,
+        PAKFILE_MERGE_LAST_WINS = 1,
+        PAKFILE_MERGE_ERROR = 2
+    };
+
+    struct Resource
+    {
+        QString name;
+        PakBufferRef buffer;
+        quint32 offset;
+        quint32 size;
+
+        Resource();
+
+        const char* data() const;
+        bool read(quint32 pos, char* out, quint32 length) const;
+
+        // Request for PakIo::write() that puts the data at offset in a file
+        PakIo::Write writeRequest(quint64 offset) const;
+    };
+
+    struct TableEntry
+    {
+        QString name;
+        quint32 offset;
+        quint32 size;
+    };
+
+    // Where everything goes when the archive is saved with the current
+    // resources and settings
+    struct Layout
+    {
+        quint64 nameOffset;
+        quint64 dataOffset;
+        quint64 pakSize;
+        QVector<quint64> dataOffsets;
+    };
+
+    static const quint32 HEADER_SIZE = 24;
+    static const quint32 TABLE_ENTRY_SIZE = 12;
+
+    PakFile();
+
+    // Largest alignment inferred from an archive's offsets and size
+    static const quint32 MAX_INFERRED_ALIGNMENT = 65536;
+
+    static PakFile* open(QString& path);
+
+    // Size of the header, resource table and name table (everything before
+    // the resource data), read from the first HEADER_SIZE bytes of a file.
+    static quint32 tableSize(const char* header);
+
+    // Parses and bounds-checks the header and resource table of an archive
+    // of pakSize bytes. Only the first tableSize() bytes of pakData are
+    // accessed. Problems are appended to errors when it is given.
+    static bool readTable(const char* pakData, quint64 pakSize, Endian* endian,
+                          QVector<TableEntry>* table, QStringList* errors = nullptr);
+
+    // The same for a whole archive, from its mapping when it is mapped and
+    // otherwise with positioned reads of just the header and tables
+    static bool readTable(const PakBuffer& pakData, Endian* endian, QVector<TableEntry>* table,
+                          QStringList* errors = nullptr);
+
+    // Largest power of two, up to limit, that value is a multiple of
+    static quint32 alignmentOf(quint64 value, quint32 limit);
+
+    // Whether every resource is still the one open() or save() put there
+    bool isUnchangedOnDisk() const;
+
+    // The settings an archive was saved with aren't stored in it. This
+    // lowers sectorSize and sizeAlign, which it starts from, to the largest
+    // powers of two the resource offsets and the archive size on disk are
+    // multiples of. Only meaningful when isUnchangedOnDisk().
+    void inferAlignment(quint32* sectorSize, quint32* sizeAlign) const;
+
+    // Lowers sectorSize and sizeAlign to what an unchanged archive has on
+    // disk when its padding doesn't fit them, so saving it elsewhere keeps
+    // that padding. The defaults are kept whenever they fit.
+    void keepDiskAlignment();
+
+    Layout layout() const;
+    // Names are stored as UTF-8 whatever the locale, so archives are the
+    // same on every machine
+    static QByteArray encodeName(const QString& name);
+    static QString decodeName(const char* name);
+
+    // Writes the archive to path, replacing the file at the end. Pointers
+    // from Resource::data() may be invalid afterwards (see
+    // PakMappedBuffer), and on Windows saving over a file that anything
+    // else has open fails.
+    bool save();
+    void deleteResource(int index);
+
+    // Combines archives into a new one with the settings of the first.
+    // Resources keep the position where their name first appears; the
+    // policy decides whose data a duplicate name gets. With
+    // PAKFILE_MERGE_ERROR, a duplicate fails the merge and its name is
+    // stored in conflict. Only buffer references are copied, so saving the
+    // result streams the data straight from the inputs.
+    static PakFile* merge(const QVector<const PakFile*>& pakFiles, MergePolicy policy,
+                          QString* conflict = nullptr);
+
+    // Splits the resources, in order, into archives with the same settings
+    // that are each at most budget bytes once saved. A resource that is
+    // too big on its own gets an archive of its own.
+    QVector<PakFile> split(quint64 budget) const;
+
+    // Loads a file as a resource named after it. The data is kept in memory
+    // while imported data fits in memoryBudget and is spilled to a
+    // temporary file otherwise (always for files over 1 GiB). Optionally
+    // returns the SHA-1 of the data.
+    bool loadResource(Resource& resource, const QString& path, QByteArray* hash = nullptr);
+
+    // Bytes of imported resource data held in memory by this file or by
+    // any copy of it (undo snapshots, split parts), until nothing holds it
+    quint64 residentSize() const;
+
+    bool unsaved;
+    QString path;
+    Endian endian;
+    PakBufferRef data;
+    quint32 sectorSize;
+    quint32 sizeAlign;
+    quint64 memoryBudget;
+    QSharedPointer<PakMemoryUsage> memoryUsage;
+    QSharedPointer<PakSpillStore> spillStore;
+    QVector<Resource> resources;
+};
+
+#endif // PAKFILE_H
@@ -0,0 +1,175 @@
+#include "pakio.h"
+
+#include <QAtomicInt>
+#include <QScopedPointer>
+#include <QThreadStorage>
+
+#ifdef PAK_HAVE_IO_URING
+#include "pakuringio.h"
+#endif
+
+#define COPY_CHUNK_SIZE (4 * 1024 * 1024)
+
+struct ThreadIo
+{
+    QScopedPointer<PakIo> io;
+    int requested;
+};
+
+static QAtomicInt preferred(PakIo::PAKIO_URING);
+static QThreadStorage<ThreadIo*> threadIo;
+
+PakIo::Write::Write()
+{
+    offset = 0;
+    length = 0;
+    data = nullptr;
+    bufferOffset = 0;
+}
+
+PakIo::~PakIo()
+{
+}
+
+PakIo* PakIo::instance()
+{
+    if (!threadIo.hasLocalData())
+    {
+        ThreadIo* local = new ThreadIo;
+        local->requested = -1;
+        threadIo.setLocalData(local);
+    }
+
+    ThreadIo* local = threadIo.localData();
+    int backend = preferred.loadAcquire();
+
+    // Created once per thread and backend: setting up a ring and its
+    // registered buffers costs more than a small batch
+    if (local->requested != backend)
+    {
+        local->io.reset(create(static_cast<Backend>(backend)));
+        local->requested = backend;
+    }
+
+    return local->io.data();
+}
+
+PakIo::Backend PakIo::preferredBackend()
+{
+    return static_cast<Backend>(preferred.loadAcquire());
+}
+
+void PakIo::setPreferredBackend(Backend backend)
+{
+    preferred.storeRelease(backend);
+}
+
+QString PakIo::backendName(Backend backend)
+{
+    return backend == PAKIO_URING ? "io_uring" : "blocking";
+}
+
+bool PakIo::readSource(const Write& write, quint64 offset, char* out, quint64 length)
+{
+    return write.buffer && write.buffer->read(write.bufferOffset + offset, out, length);
+}
+
+PakIo* PakIo::create(Backend backend)
+{
+#ifdef PAK_HAVE_IO_URING
+    if (backend == PAKIO_URING)
+    {
+        PakIo* io = PakUringIo::create();
+
+        if (io)
+        {
+            return io;
+        }
+    }
+#else
+    Q_UNUSED(backend);
+#endif
+
+    return new PakBlockingIo;
+}
+
+PakIo::Backend PakBlockingIo::backend() const
+{
+    return PAKIO_BLOCKING;
+}
+
+bool PakBlockingIo::read(QFileDevice* file, const QVector<Read>& reads)
+{
+    for (const Read& read : reads)
+    {
+        if (!file->seek(read.offset) || file->read(read.data, read.length) != static_cast<qint64>(read.length))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool PakBlockingIo::write(QFileDevice* file, const QVector<Write>& writes, quint64 size)
+{
+    // Sequential, with the gaps written out as zeros
+    quint64 position = 0;
+    QByteArray chunk;
+
+    for (const Write& write : writes)
+    {
+        if (!writeZeros(file, write.offset - position))
+        {
+            return false;
+        }
+
+        if (write.data)
+        {
+            if (file->write(write.data, write.length) != static_cast<qint64>(write.length))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            chunk.resize(static_cast<int>(qMin<quint64>(write.length, COPY_CHUNK_SIZE)));
+
+            for (quint64 done = 0; done < write.length;)
+            {
+                quint64 length = qMin<quint64>(write.length - done, COPY_CHUNK_SIZE);
+
+                if (!readSource(write, done, chunk.data(), length) ||
+                    file->write(chunk.constData(), length) != static_cast<qint64>(length))
+                {
+                    return false;
+                }
+
+                done += length;
+            }
+        }
+
+        position = write.offset + write.length;
+    }
+
+    return writeZeros(file, size - position);
+}
+
+bool PakBlockingIo::writeZeros(QIODevice* device, quint64 count)
+{
+    static const QByteArray zeros(64 * 1024, '\0');
+
+    while (count > 0)
+    {
+        qint64 length = qMin<quint64>(count, zeros.size());
+
+        if (device->write(zeros.constData(), length) != length)
+        {
+            return false;
+        }
+
+        count -= length;
+    }
+
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef PAKIO_H
+#define PAKIO_H
+
+#include <QFileDevice>
+#include <QString>
+#include <QVector>
+
+#include "pakbuffer.h"
+
+// Positioned reads and writes in batches. The requests in a batch don't
+// depend on each other, so a backend may keep many of them in flight at
+// once: the io_uring backend (Linux, built with CONFIG+=pak_io_uring)
+// keeps the device queue busy; the blocking backend runs them one at a
+// time with QFile, as PakTool always has. The io_uring backend falls back
+// to the blocking one when the kernel doesn't support it.
+class PakIo
+{
+public:
+    enum Backend
+    {
+        PAKIO_BLOCKING = 0,
+        PAKIO_URING = 1
+    };
+
+    struct Read
+    {
+        quint64 offset;
+        char* data;
+        quint64 length;
+    };
+
+    // length bytes to write at offset, taken from data or, when data is
+    // nullptr, from buffer at bufferOffset (e.g. a resource that is not
+    // resident in memory)
+    struct Write
+    {
+        quint64 offset;
+        quint64 length;
+        const char* data;
+        PakBufferRef buffer;
+        quint64 bufferOffset;
+
+        Write();
+    };
+
+    virtual ~PakIo();
+
+    virtual Backend backend() const = 0;
+
+    // Fills every read from file, which must be open for reading
+    virtual bool read(QFileDevice* file, const QVector<Read>& reads) = 0;
+
+    // Writes a whole file of size bytes to an empty file opened for
+    // writing. Writes must be in ascending order and not overlap; bytes
+    // that no write covers are zero.
+    virtual bool write(QFileDevice* file, const QVector<Write>& writes, quint64 size) = 0;
+
+    // The calling thread's instance, using the preferred backend when it
+    // is available
+    static PakIo* instance();
+
+    static Backend preferredBackend();
+    static void setPreferredBackend(Backend backend);
+    static QString backendName(Backend backend);
+
+protected:
+    // Reads part of the source of a write that has no data pointer
+    static bool readSource(const Write& write, quint64 offset, char* out, quint64 length);
+
+private:
+    static PakIo* create(Backend backend);
+};
+
+class PakBlockingIo : public PakIo
+{
+public:
+    Backend backend() const override;
+    bool read(QFileDevice* file, const QVector<Read>& reads) override;
+    bool write(QFileDevice* file, const QVector<Write>& writes, quint64 size) override;
+
+private:
+    static bool writeZeros(QIODevice* device, quint64 count);
+};
+
+#endif // PAKIO_H
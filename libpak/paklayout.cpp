@@ -0,0 +1,233 @@
+#include "paklayout.h"
+
+#include <algorithm>
+
+#define align(val, alignment) (((val) + (alignment) - 1) & -(alignment))
+
+PakLayout::PakLayout()
+{
+    sectorSize = 0;
+    sizeAlign = 0;
+    order = PAKLAYOUT_ORDER_CURRENT;
+    pakSize = 0;
+    headerSize = 0;
+    tableSize = 0;
+    nameSize = 0;
+    dataSize = 0;
+    tablePadding = 0;
+    dataPadding = 0;
+    tailPadding = 0;
+}
+
+PakLayout PakLayout::analyze(const PakFile& pakFile)
+{
+    if (!pakFile.isUnchangedOnDisk())
+    {
+        return simulate(pakFile, pakFile.sectorSize, pakFile.sizeAlign, PAKLAYOUT_ORDER_CURRENT);
+    }
+
+    // Report the alignment the offsets and size actually have
+    PakLayout layout;
+    QVector<quint64> offsets;
+
+    layout.pakSize = pakFile.data->size();
+    layout.sectorSize = pakFile.sectorSize;
+    layout.sizeAlign = PakFile::MAX_INFERRED_ALIGNMENT;
+
+    if (!pakFile.resources.isEmpty())
+    {
+        layout.sectorSize = PakFile::MAX_INFERRED_ALIGNMENT;
+    }
+
+    pakFile.inferAlignment(&layout.sectorSize, &layout.sizeAlign);
+
+    offsets.reserve(pakFile.resources.count());
+
+    for (const PakFile::Resource& resource : pakFile.resources)
+    {
+        offsets.append(resource.offset);
+    }
+
+    layout.account(pakFile.resources, offsets);
+
+    return layout;
+}
+
+PakLayout PakLayout::simulate(const PakFile& pakFile, quint32 sectorSize, quint32 sizeAlign, Order order)
+{
+    // Copying only copies buffer references
+    PakFile copy = pakFile;
+    QVector<PakFile::Resource>& resources = copy.resources;
+
+    copy.sectorSize = sectorSize;
+    copy.sizeAlign = sizeAlign;
+
+    if (order == PAKLAYOUT_ORDER_NAME)
+    {
+        std::stable_sort(resources.begin(), resources.end(),
+                         [](const PakFile::Resource& a, const PakFile::Resource& b) { return a.name < b.name; });
+    }
+    else if (order == PAKLAYOUT_ORDER_SIZE)
+    {
+        std::stable_sort(resources.begin(), resources.end(),
+                         [](const PakFile::Resource& a, const PakFile::Resource& b) { return a.size > b.size; });
+    }
+    else if (order == PAKLAYOUT_ORDER_BEST && !resources.isEmpty())
+    {
+        int worst = 0;
+        quint64 worstPadding = 0;
+
+        for (int i = 0; i < resources.count(); i++)
+        {
+            quint64 size = resources[i].size;
+            quint64 padding = align(size, static_cast<quint64>(sectorSize)) - size;
+
+            if (padding > worstPadding)
+            {
+                worst = i;
+                worstPadding = padding;
+            }
+        }
+
+        PakFile::Resource last = resources.takeAt(worst);
+        resources.append(last);
+    }
+
+    PakFile::Layout pakLayout = copy.layout();
+    PakLayout layout;
+
+    layout.sectorSize = sectorSize;
+    layout.sizeAlign = sizeAlign;
+    layout.order = order;
+    layout.pakSize = pakLayout.pakSize;
+    layout.account(resources, pakLayout.dataOffsets);
+
+    return layout;
+}
+
+QString PakLayout::orderName(Order order)
+{
+    switch (order)
+    {
+    case PAKLAYOUT_ORDER_NAME:
+        return "name";
+    case PAKLAYOUT_ORDER_SIZE:
+        return "size";
+    case PAKLAYOUT_ORDER_BEST:
+        return "best";
+    default:
+        return "current";
+    }
+}
+
+bool PakLayout::parseOrder(const QString& name, Order* order)
+{
+    for (int i = PAKLAYOUT_ORDER_CURRENT; i <= PAKLAYOUT_ORDER_BEST; i++)
+    {
+        if (name == orderName(static_cast<Order>(i)))
+        {
+            *order = static_cast<Order>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+quint64 PakLayout::wasted() const
+{
+    return tablePadding + dataPadding + tailPadding;
+}
+
+void PakLayout::account(const QVector<PakFile::Resource>& resources, const QVector<quint64>& offsets)
+{
+    int count = resources.count();
+
+    headerSize = PakFile::HEADER_SIZE;
+    tableSize = static_cast<quint64>(PakFile::TABLE_ENTRY_SIZE) * count;
+    nameSize = 0;
+    dataSize = 0;
+    tablePadding = 0;
+    dataPadding = 0;
+    tailPadding = 0;
+
+    this->resources.resize(count);
+    histogram.clear();
+
+    for (int i = 0; i < count; i++)
+    {
+        ResourceUsage& usage = this->resources[i];
+
+        usage.name = resources[i].name;
+        usage.offset = offsets[i];
+        usage.size = resources[i].size;
+        usage.padding = 0;
+
+        nameSize += PakFile::encodeName(usage.name).size() + 1;
+        dataSize += usage.size;
+    }
+
+    quint64 tableEnd = headerSize + tableSize + nameSize;
+
+    if (count == 0)
+    {
+        tailPadding = pakSize > tableEnd ? pakSize - tableEnd : 0;
+        return;
+    }
+
+    // Walk the resources in file order; the gap after each one is its
+    // padding. Resources sharing data (or overlapping) have none.
+    QVector<int> fileOrder(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        fileOrder[i] = i;
+    }
+
+    std::stable_sort(fileOrder.begin(), fileOrder.end(), [&offsets](int a, int b) { return offsets[a] < offsets[b]; });
+
+    quint64 firstOffset = offsets[fileOrder.first()];
+    tablePadding = firstOffset > tableEnd ? firstOffset - tableEnd : 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        ResourceUsage& usage = this->resources[fileOrder[i]];
+        quint64 end = usage.offset + usage.size;
+        quint64 next = i + 1 < count ? offsets[fileOrder[i + 1]] : pakSize;
+
+        usage.padding = next > end ? next - end : 0;
+
+        if (i + 1 < count)
+        {
+            dataPadding += usage.padding;
+        }
+        else
+        {
+            tailPadding = usage.padding;
+        }
+    }
+
+    for (const ResourceUsage& usage : this->resources)
+    {
+        int bucket = 0;
+
+        while (bucket < 32 && (1ULL << bucket) <= usage.size)
+        {
+            bucket++;
+        }
+
+        while (histogram.count() <= bucket)
+        {
+            SizeBucket sizeBucket;
+            sizeBucket.limit = 1ULL << histogram.count();
+            sizeBucket.count = 0;
+            sizeBucket.dataSize = 0;
+            sizeBucket.padding = 0;
+            histogram.append(sizeBucket);
+        }
+
+        histogram[bucket].count++;
+        histogram[bucket].dataSize += usage.size;
+        histogram[bucket].padding += usage.padding;
+    }
+}
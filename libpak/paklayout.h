@@ -0,0 +1,85 @@
+#ifndef PAKLAYOUT_H
+#define PAKLAYOUT_H
+
+#include <QString>
+#include <QVector>
+
+#include "pakfile.h"
+
+// Accounts for every byte of an archive: the header, resource and name
+// tables, resource data, and the padding that aligns the data to sectors
+// and the archive to sizeAlign. Archives can also be laid out with other
+// settings and resource orders to see what they would cost, without
+// writing anything.
+class PakLayout
+{
+public:
+    enum Order
+    {
+        PAKLAYOUT_ORDER_CURRENT = 0,
+        PAKLAYOUT_ORDER_NAME = 1,
+        PAKLAYOUT_ORDER_SIZE = 2,
+
+        // Only the last resource escapes sector padding, so the least
+        // padding comes from putting the worst padded resource last
+        PAKLAYOUT_ORDER_BEST = 3
+    };
+
+    struct ResourceUsage
+    {
+        QString name;
+        quint64 offset;
+        quint32 size;
+
+        // Bytes between the end of this resource and the next one (or the
+        // end of the archive)
+        quint64 padding;
+    };
+
+    // Resources bucketed by size: bucket i holds sizes below 2^i
+    struct SizeBucket
+    {
+        quint64 limit;
+        int count;
+        quint64 dataSize;
+        quint64 padding;
+    };
+
+    PakLayout();
+
+    // The layout the archive has on disk when it was opened and has not
+    // been changed since, otherwise the layout save() would write
+    static PakLayout analyze(const PakFile& pakFile);
+
+    // The layout save() would write with these settings and order
+    static PakLayout simulate(const PakFile& pakFile, quint32 sectorSize, quint32 sizeAlign, Order order);
+
+    static QString orderName(Order order);
+    static bool parseOrder(const QString& name, Order* order);
+
+    quint64 wasted() const;
+
+    quint32 sectorSize;
+    quint32 sizeAlign;
+    Order order;
+    quint64 pakSize;
+    quint64 headerSize;
+    quint64 tableSize;
+    quint64 nameSize;
+    quint64 dataSize;
+
+    // Between the name table and the first resource
+    quint64 tablePadding;
+
+    // Between resources, and after the last one
+    quint64 dataPadding;
+    quint64 tailPadding;
+
+    QVector<ResourceUsage> resources;
+    QVector<SizeBucket> histogram;
+
+private:
+    void account(const QVector<PakFile::Resource>& resources, const QVector<quint64>& offsets);
+};
+
+#endif // PAKLAYOUT_H
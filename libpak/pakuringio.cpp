@@ -0,0 +1,408 @@
+#include "pakuringio.h"
+
+#include <QList>
+
+#include <cerrno>
+#include <sys/uio.h>
+
+PakUringIo::PakUringIo()
+{
+    ringReady = false;
+    pool = nullptr;
+    registered = false;
+}
+
+PakUringIo::~PakUringIo()
+{
+    if (ringReady)
+    {
+        io_uring_queue_exit(&ring);
+    }
+
+    qFreeAligned(pool);
+}
+
+PakUringIo* PakUringIo::create()
+{
+    PakUringIo* io = new PakUringIo;
+
+    if (!io->setUpRing())
+    {
+        delete io;
+        return nullptr;
+    }
+
+    // Plain reads and writes need Linux 5.6
+    io_uring_probe* probe = io_uring_get_probe_ring(&io->ring);
+    bool supported = probe && io_uring_opcode_supported(probe, IORING_OP_READ) &&
+                     io_uring_opcode_supported(probe, IORING_OP_WRITE);
+
+    if (probe)
+    {
+        io_uring_free_probe(probe);
+    }
+
+    if (!supported)
+    {
+        delete io;
+        return nullptr;
+    }
+
+    return io;
+}
+
+bool PakUringIo::setUpRing()
+{
+    ringReady = io_uring_queue_init(QUEUE_DEPTH, &ring, 0) == 0;
+    registered = false;
+
+    if (!ringReady)
+    {
+        return false;
+    }
+
+    if (pool)
+    {
+        registerPool();
+    }
+
+    return true;
+}
+
+bool PakUringIo::allocatePool()
+{
+    // Only copies between files need the pool, so threads that only read
+    // or write from memory never allocate it
+    if (!pool)
+    {
+        pool = static_cast<char*>(qMallocAligned(QUEUE_DEPTH * CHUNK_SIZE, 4096));
+
+        if (!pool)
+        {
+            return false;
+        }
+
+        registerPool();
+    }
+
+    return true;
+}
+
+void PakUringIo::registerPool()
+{
+    // Registering pins the pool in memory, which RLIMIT_MEMLOCK may not
+    // allow; the pool then works as plain buffers
+    iovec iovecs[QUEUE_DEPTH];
+
+    for (unsigned i = 0; i < QUEUE_DEPTH; i++)
+    {
+        iovecs[i].iov_base = pool + i * CHUNK_SIZE;
+        iovecs[i].iov_len = CHUNK_SIZE;
+    }
+
+    registered = io_uring_register_buffers(&ring, iovecs, QUEUE_DEPTH) == 0;
+}
+
+void PakUringIo::resetRing(unsigned submitted)
+{
+    // Submitted requests still read into or write from the caller's data
+    // and the pool, so they are waited for before anything is reused.
+    // Queued requests that never got submitted can't be taken back, which
+    // is why the ring is replaced instead of reused.
+    while (submitted > 0)
+    {
+        io_uring_cqe* cqe;
+        int result = io_uring_wait_cqe(&ring, &cqe);
+
+        if (result == -EINTR)
+        {
+            continue;
+        }
+
+        if (result < 0)
+        {
+            break;
+        }
+
+        io_uring_cqe_seen(&ring, cqe);
+        submitted--;
+    }
+
+    io_uring_queue_exit(&ring);
+    setUpRing();
+}
+
+PakIo::Backend PakUringIo::backend() const
+{
+    return PAKIO_URING;
+}
+
+bool PakUringIo::read(QFileDevice* file, const QVector<Read>& reads)
+{
+    int fd = file->handle();
+    QVector<Op> ops;
+
+    // The ring couldn't be set up again after it failed
+    if (!ringReady)
+    {
+        return PakBlockingIo().read(file, reads);
+    }
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    for (const Read& read : reads)
+    {
+        for (quint64 done = 0; done < read.length; done += CHUNK_SIZE)
+        {
+            Op op;
+            op.stage = STAGE_READ;
+            op.fd = fd;
+            op.offset = read.offset + done;
+            op.data = read.data + done;
+            op.length = qMin<quint64>(read.length - done, CHUNK_SIZE);
+            op.done = 0;
+            op.buffer = -1;
+            ops.append(op);
+        }
+    }
+
+    return run(ops);
+}
+
+bool PakUringIo::write(QFileDevice* file, const QVector<Write>& writes, quint64 size)
+{
+    int fd = file->handle();
+    QVector<Op> ops;
+
+    // Sources that are neither in memory nor in a file are read up front
+    QList<QByteArray> staged;
+
+    if (!ringReady)
+    {
+        return PakBlockingIo().write(file, writes, size);
+    }
+
+    // Setting the size first leaves the gaps zero without writing them
+    if (fd < 0 || !file->resize(size))
+    {
+        return false;
+    }
+
+    for (const Write& write : writes)
+    {
+        const char* data = write.data;
+        quint64 sourceOffset = 0;
+        int sourceFd = -1;
+
+        if (!data && write.buffer)
+        {
+            data = write.buffer->data() ? write.buffer->data() + write.bufferOffset : nullptr;
+            sourceFd = data ? -1 : write.buffer->fileHandle(&sourceOffset);
+        }
+
+        // Without memory for the pool, the blocking backend copies through
+        // a single buffer instead
+        if (!data && sourceFd >= 0 && !allocatePool())
+        {
+            return PakBlockingIo().write(file, writes, size);
+        }
+
+        if (!data && sourceFd < 0)
+        {
+            QByteArray bytes(static_cast<int>(write.length), Qt::Uninitialized);
+
+            if (!readSource(write, 0, bytes.data(), write.length))
+            {
+                return false;
+            }
+
+            staged.append(bytes);
+            data = staged.last().constData();
+        }
+
+        for (quint64 done = 0; done < write.length; done += CHUNK_SIZE)
+        {
+            Op op;
+            op.length = qMin<quint64>(write.length - done, CHUNK_SIZE);
+            op.done = 0;
+            op.buffer = -1;
+
+            if (data)
+            {
+                op.stage = STAGE_WRITE;
+                op.fd = fd;
+                op.offset = write.offset + done;
+                op.data = const_cast<char*>(data + done);
+            }
+            else
+            {
+                op.stage = STAGE_COPY_READ;
+                op.fd = sourceFd;
+                op.offset = sourceOffset + write.bufferOffset + done;
+                op.data = nullptr;
+                op.targetFd = fd;
+                op.targetOffset = write.offset + done;
+            }
+
+            ops.append(op);
+        }
+    }
+
+    return run(ops);
+}
+
+bool PakUringIo::run(QVector<Op>& ops)
+{
+    QVector<int> freeBuffers;
+    QVector<int> ready;
+    int next = 0;
+    unsigned inFlight = 0;
+    bool failed = false;
+
+    for (int i = QUEUE_DEPTH - 1; i >= 0; i--)
+    {
+        freeBuffers.append(i);
+    }
+
+    for (;;)
+    {
+        // Queue resubmissions first: they already hold a pool buffer
+        while (!failed && inFlight < QUEUE_DEPTH)
+        {
+            int index;
+
+            if (!ready.isEmpty())
+            {
+                index = ready.takeLast();
+            }
+            else if (next < ops.count())
+            {
+                Op& op = ops[next];
+
+                if (op.stage == STAGE_COPY_READ)
+                {
+                    if (freeBuffers.isEmpty())
+                    {
+                        break;
+                    }
+
+                    op.buffer = freeBuffers.takeLast();
+                    op.data = pool + op.buffer * CHUNK_SIZE;
+                }
+
+                index = next++;
+            }
+            else
+            {
+                break;
+            }
+
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+
+            prepare(sqe, ops[index]);
+            io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<quintptr>(index)));
+            inFlight++;
+        }
+
+        if (inFlight == 0)
+        {
+            break;
+        }
+
+        int result = io_uring_submit_and_wait(&ring, 1);
+
+        // Anything else means the ring itself is unusable. Requests left in
+        // it still refer to ops by index, so it can't be handed to the next
+        // run as it is.
+        if (result < 0 && result != -EINTR && result != -EAGAIN && result != -EBUSY)
+        {
+            resetRing(inFlight - io_uring_sq_ready(&ring));
+            return false;
+        }
+
+        io_uring_cqe* cqe;
+        unsigned head;
+        unsigned seen = 0;
+
+        io_uring_for_each_cqe(&ring, head, cqe)
+        {
+            int index = static_cast<int>(reinterpret_cast<quintptr>(io_uring_cqe_get_data(cqe)));
+            Op& op = ops[index];
+            int res = cqe->res;
+
+            seen++;
+            inFlight--;
+
+            if (res == -EINTR || res == -EAGAIN)
+            {
+                ready.append(index);
+                continue;
+            }
+
+            // An error, or the end of the file before the data did
+            if (res <= 0)
+            {
+                failed = true;
+                continue;
+            }
+
+            // Short reads and writes carry on where they stopped
+            op.done += res;
+
+            if (op.done < op.length)
+            {
+                ready.append(index);
+            }
+            else if (op.stage == STAGE_COPY_READ)
+            {
+                op.stage = STAGE_WRITE;
+                op.fd = op.targetFd;
+                op.offset = op.targetOffset;
+                op.done = 0;
+                ready.append(index);
+            }
+            else if (op.buffer >= 0)
+            {
+                freeBuffers.append(op.buffer);
+            }
+        }
+
+        io_uring_cq_advance(&ring, seen);
+    }
+
+    return !failed;
+}
+
+void PakUringIo::prepare(io_uring_sqe* sqe, const Op& op) const
+{
+    char* data = op.data + op.done;
+    unsigned length = static_cast<unsigned>(op.length - op.done);
+    quint64 offset = op.offset + op.done;
+    bool fixed = registered && op.buffer >= 0;
+
+    if (op.stage == STAGE_WRITE)
+    {
+        if (fixed)
+        {
+            io_uring_prep_write_fixed(sqe, op.fd, data, length, offset, op.buffer);
+        }
+        else
+        {
+            io_uring_prep_write(sqe, op.fd, data, length, offset);
+        }
+    }
+    else
+    {
+        if (fixed)
+        {
+            io_uring_prep_read_fixed(sqe, op.fd, data, length, offset, op.buffer);
+        }
+        else
+        {
+            io_uring_prep_read(sqe, op.fd, data, length, offset);
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef PAKURINGIO_H
+#define PAKURINGIO_H
+
+#include <liburing.h>
+
+#include "pakio.h"
+
+// io_uring backend for PakIo. Requests are split into chunks of at most
+// CHUNK_SIZE and up to QUEUE_DEPTH of them are in flight at a time. Data
+// copied from a file into another (resources that aren't resident in
+// memory) goes through a pool of buffers registered with the ring, so the
+// kernel doesn't have to map them for every request. The pool is only
+// allocated by the first such copy.
+class PakUringIo : public PakIo
+{
+public:
+    ~PakUringIo() override;
+
+    // Returns nullptr when the kernel has no usable io_uring
+    static PakUringIo* create();
+
+    Backend backend() const override;
+    bool read(QFileDevice* file, const QVector<Read>& reads) override;
+    bool write(QFileDevice* file, const QVector<Write>& writes, quint64 size) override;
+
+private:
+    static const unsigned QUEUE_DEPTH = 32;
+    static const unsigned CHUNK_SIZE = 256 * 1024;
+
+    enum Stage
+    {
+        STAGE_READ,
+        STAGE_COPY_READ,
+        STAGE_WRITE
+    };
+
+    struct Op
+    {
+        Stage stage;
+        int fd;
+        quint64 offset;
+        char* data;
+        quint64 length;
+        quint64 done;
+
+        // Pool buffer used by a copy, or -1
+        int buffer;
+
+        // Where a copy writes its data once it has been read
+        int targetFd;
+        quint64 targetOffset;
+    };
+
+    PakUringIo();
+
+    bool setUpRing();
+    bool allocatePool();
+    void registerPool();
+    void resetRing(unsigned submitted);
+    bool run(QVector<Op>& ops);
+    void prepare(io_uring_sqe* sqe, const Op& op) const;
+
+    io_uring ring;
+    bool ringReady;
+    char* pool;
+    bool registered;
+};
+
+#endif // PAKURINGIO_H
@@ -0,0 +1,307 @@
+#include "pakverifier.h"
+
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+
+#include "pakfile.h"
+
+#define HASH_CHUNK_SIZE (8 * 1024 * 1024)
+#define MIN_RUN_SIZE (1024 * 1024)
+#define MAX_RUN_SIZE (64 * 1024 * 1024)
+
+// Hashes a run of resources that are contiguous on disk, so every pool
+// thread reads its own sequential stretch of the file.
+class PakHashTask : public QRunnable
+{
+public:
+    PakHashTask(const QString& path, const uchar* mapped, const QVector<PakFile::TableEntry>& table,
+                const QVector<int>& indices, PakVerifier::ResourceHash* hashes, QAtomicInt& failed)
+        : path(path), mapped(mapped), table(table), indices(indices), hashes(hashes), failed(failed)
+    {
+    }
+
+    void run() override
+    {
+        QFile file;
+        QByteArray chunk;
+
+        if (!mapped)
+        {
+            file.setFileName(path);
+
+            if (!file.open(QFile::ReadOnly))
+            {
+                failed.storeRelease(1);
+                return;
+            }
+
+            chunk.resize(HASH_CHUNK_SIZE);
+        }
+
+        for (int index : indices)
+        {
+            const PakFile::TableEntry& entry = table[index];
+            QCryptographicHash hash(QCryptographicHash::Sha1);
+
+            if (!mapped && !file.seek(entry.offset))
+            {
+                failed.storeRelease(1);
+                return;
+            }
+
+            for (quint32 done = 0; done < entry.size;)
+            {
+                int length = qMin<quint32>(HASH_CHUNK_SIZE, entry.size - done);
+
+                if (mapped)
+                {
+                    hash.addData(reinterpret_cast<const char*>(mapped) + entry.offset + done, length);
+                }
+                else
+                {
+                    if (file.read(chunk.data(), length) != length)
+                    {
+                        failed.storeRelease(1);
+                        return;
+                    }
+
+                    hash.addData(chunk.constData(), length);
+                }
+
+                done += length;
+            }
+
+            hashes[index].hash = hash.result();
+        }
+    }
+
+private:
+    QString path;
+    const uchar* mapped;
+    const QVector<PakFile::TableEntry>& table;
+    QVector<int> indices;
+    PakVerifier::ResourceHash* hashes;
+    QAtomicInt& failed;
+};
+
+PakVerifier::PakVerifier()
+{
+    threadCount = 0;
+    bytesHashed = 0;
+}
+
+bool PakVerifier::verify(const QString& path)
+{
+    errors.clear();
+    hashes.clear();
+    bytesHashed = 0;
+
+    // Mapped when possible; otherwise only the header and tables are read
+    // up front, and the hashing threads read the file themselves
+    PakBufferRef pakData = PakMappedBuffer::open(path);
+
+    if (!pakData)
+    {
+        pakData = PakFileBuffer::open(path);
+    }
+
+    if (!pakData)
+    {
+        errors.append(QString("Could not open %1.").arg(path));
+        return false;
+    }
+
+    const uchar* mapped = reinterpret_cast<const uchar*>(pakData->data());
+    PakFile::Endian endian;
+    QVector<PakFile::TableEntry> table;
+
+    if (!PakFile::readTable(*pakData, &endian, &table, &errors))
+    {
+        return false;
+    }
+
+    hashes.resize(table.count());
+
+    for (int i = 0; i < table.count(); i++)
+    {
+        hashes[i].name = table[i].name;
+        hashes[i].size = table[i].size;
+    }
+
+    // Resources must not overlap each other
+    QVector<int> order(table.count());
+
+    for (int i = 0; i < order.count(); i++)
+    {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&](int a, int b)
+    {
+        return table[a].offset < table[b].offset;
+    });
+
+    quint64 totalSize = 0;
+    quint64 previousEnd = 0;
+
+    for (int i = 0; i < order.count(); i++)
+    {
+        const PakFile::TableEntry& entry = table[order[i]];
+
+        if (entry.size > 0 && entry.offset < previousEnd)
+        {
+            errors.append(QString("Resource %1 (%2) overlaps another resource.").arg(order[i]).arg(entry.name));
+        }
+
+        previousEnd = qMax<quint64>(previousEnd, static_cast<quint64>(entry.offset) + entry.size);
+        totalSize += entry.size;
+    }
+
+    if (!errors.empty())
+    {
+        return false;
+    }
+
+    // Split the resources into contiguous runs, sized so every thread gets
+    // a few of them
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount > 0 ? threadCount : QThread::idealThreadCount());
+
+    quint64 runSize = qBound<quint64>(MIN_RUN_SIZE, totalSize / (pool.maxThreadCount() * 4), MAX_RUN_SIZE);
+    QAtomicInt failed(0);
+    ResourceHash* hashData = hashes.data();
+    QVector<int> run;
+    quint64 runBytes = 0;
+
+    for (int i = 0; i < order.count(); i++)
+    {
+        run.append(order[i]);
+        runBytes += table[order[i]].size;
+
+        if (runBytes >= runSize || i == order.count() - 1)
+        {
+            pool.start(new PakHashTask(path, mapped, table, run, hashData, failed));
+            run.clear();
+            runBytes = 0;
+        }
+    }
+
+    pool.waitForDone();
+
+    if (failed.loadAcquire())
+    {
+        errors.append(QString("Could not read resource data from %1.").arg(path));
+        return false;
+    }
+
+    bytesHashed = totalSize;
+
+    return true;
+}
+
+bool PakVerifier::compare(const QVector<ResourceHash>& reference, const QString& referenceName)
+{
+    bool match = true;
+
+    if (reference.count() != hashes.count())
+    {
+        errors.append(QString("Resource count %1 does not match %2 in %3.")
+                      .arg(hashes.count()).arg(reference.count()).arg(referenceName));
+        match = false;
+    }
+
+    for (int i = 0; i < qMin(reference.count(), hashes.count()); i++)
+    {
+        const ResourceHash& actual = hashes[i];
+        const ResourceHash& expected = reference[i];
+
+        if (actual.name != expected.name)
+        {
+            errors.append(QString("Resource %1 is named %2, expected %3.").arg(i).arg(actual.name, expected.name));
+            match = false;
+        }
+        else if (actual.size != expected.size || actual.hash != expected.hash)
+        {
+            errors.append(QString("Resource %1 (%2) does not match %3.").arg(i).arg(actual.name, referenceName));
+            match = false;
+        }
+    }
+
+    return match;
+}
+
+bool PakVerifier::readManifest(const QString& path, QVector<ResourceHash>* hashes, QString* error)
+{
+    QFile file(path);
+
+    if (!file.open(QFile::ReadOnly))
+    {
+        *error = QString("Could not open manifest %1.").arg(path);
+        return false;
+    }
+
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+
+    file.close();
+
+    if (!document.isObject())
+    {
+        *error = QString("Could not parse manifest %1.").arg(path);
+        return false;
+    }
+
+    hashes->clear();
+
+    for (const QJsonValue& value : document.object().value("resources").toArray())
+    {
+        QJsonObject object = value.toObject();
+        ResourceHash resourceHash;
+
+        resourceHash.name = object.value("name").toString();
+        resourceHash.size = object.value("size").toVariant().toUInt();
+        resourceHash.hash = QByteArray::fromHex(object.value("hash").toString().toLatin1());
+
+        hashes->append(resourceHash);
+    }
+
+    return true;
+}
+
+bool PakVerifier::writeManifest(const QString& path, const QVector<ResourceHash>& hashes)
+{
+    QJsonArray resourceArray;
+
+    for (const ResourceHash& resourceHash : hashes)
+    {
+        QJsonObject object;
+        object.insert("name", resourceHash.name);
+        object.insert("size", static_cast<qint64>(resourceHash.size));
+        object.insert("hash", QString::fromLatin1(resourceHash.hash.toHex()));
+        resourceArray.append(object);
+    }
+
+    QJsonObject root;
+    root.insert("resources", resourceArray);
+
+    QFile file(path);
+
+    if (!file.open(QFile::WriteOnly))
+    {
+        return false;
+    }
+
+    bool success = file.write(QJsonDocument(root).toJson()) >= 0;
+
+    file.close();
+
+    return success;
+}
@@ -0,0 +1,41 @@
+#ifndef PAKVERIFIER_H
+#define PAKVERIFIER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Checks that a PAK file is intact. The header and table are validated
+// first, then every resource is hashed (SHA-1) in parallel: resources are
+// grouped into runs that are contiguous on disk and each run is hashed by
+// one pool thread, reading straight from a mapping of the file (or with
+// positioned reads when the file can't be mapped). The hashes can be
+// compared against a manifest or against another archive.
+class PakVerifier
+{
+public:
+    struct ResourceHash
+    {
+        QString name;
+        quint32 size;
+        QByteArray hash;
+    };
+
+    PakVerifier();
+
+    bool verify(const QString& path);
+    bool compare(const QVector<ResourceHash>& reference, const QString& referenceName);
+
+    // Manifests are JSON objects with a "resources" array of name, size
+    // and hash entries. Build records written by PakBuilder are accepted.
+    static bool readManifest(const QString& path, QVector<ResourceHash>* hashes, QString* error);
+    static bool writeManifest(const QString& path, const QVector<ResourceHash>& hashes);
+
+    int threadCount;
+    quint64 bytesHashed;
+    QVector<ResourceHash> hashes;
+    QStringList errors;
+};
+
+#endif // PAKVERIFIER_H
@@ -0,0 +1,41 @@
+# Shared library exporting the libpak C API (pak.h), for tools written in
+# other languages (Python ctypes, C# P/Invoke...) to use in-process.
+
+QT       = core
+
+TEMPLATE = lib
+TARGET = pakc
+
+CONFIG += c++11 shared hide_symbols
+
+DEFINES += PAK_SHARED_BUILD
+
+# Only the pak_* functions are exported. hide_symbols only covers pak.cpp;
+# the static libpak and the Qt templates it instantiates need the export list.
+linux: QMAKE_LFLAGS += -Wl,--version-script=$$PWD/pakc.map
+macx: QMAKE_LFLAGS += -Wl,-exported_symbols_list,$$PWD/pakc.exp
+
+OTHER_FILES += \
+    pakc.map \
+    pakc.exp
+
+SOURCES += \
+    ../libpak/pak.cpp
+
+HEADERS += \
+    ../libpak/pak.h
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../libpak/release/ -lpak
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../libpak/debug/ -lpak
+else:unix: LIBS += -L$$OUT_PWD/../libpak/ -lpak
+
+pak_io_uring: LIBS += -luring
+
+INCLUDEPATH += $$PWD/../libpak
+DEPENDPATH += $$PWD/../libpak
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/release/libpak.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/debug/libpak.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/release/pak.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/debug/pak.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../libpak/libpak.a
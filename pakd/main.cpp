@@ -0,0 +1,63 @@
+#include "pakserver.h"
+
+#include <QCoreApplication>
+#include <QTextStream>
+
+static int usage()
+{
+    QTextStream err(stderr);
+
+    err << "Usage:\n"
+        << "  pakd [--name <server>] [--cache <MiB>] [--inline-limit <KiB>] [--max-archives <n>]\n"
+        << "\n"
+        << "Serves resources of PAK files to local clients (see pakserver.h).\n";
+
+    return 2;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList arguments = a.arguments().mid(1);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    PakServer server;
+    QString name = "pakd";
+
+    for (int i = 0; i < arguments.count(); i++)
+    {
+        const QString& argument = arguments[i];
+
+        if (argument == "--name" && i + 1 < arguments.count())
+        {
+            name = arguments[++i];
+        }
+        else if (argument == "--cache" && i + 1 < arguments.count())
+        {
+            server.cacheSize = arguments[++i].toULongLong() * 1024 * 1024;
+        }
+        else if (argument == "--inline-limit" && i + 1 < arguments.count())
+        {
+            server.inlineLimit = arguments[++i].toUInt() * 1024;
+        }
+        else if (argument == "--max-archives" && i + 1 < arguments.count())
+        {
+            server.maxArchives = arguments[++i].toInt();
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    if (!server.listen(name))
+    {
+        err << server.errorString << "\n";
+        return 1;
+    }
+
+    out << "Listening on " << name << "\n";
+    out.flush();
+
+    return a.exec();
+}
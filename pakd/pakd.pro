@@ -0,0 +1,35 @@
+# Local daemon serving PAK resources to other processes (see pakserver.h)
+
+QT       = core network
+
+TARGET = pakd
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+SOURCES += \
+    main.cpp \
+    pakserver.cpp
+
+HEADERS += \
+    pakserver.h
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../libpak/release/ -lpak
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../libpak/debug/ -lpak
+else:unix: LIBS += -L$$OUT_PWD/../libpak/ -lpak
+
+pak_io_uring: LIBS += -luring
+
+INCLUDEPATH += $$PWD/../libpak
+DEPENDPATH += $$PWD/../libpak
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/release/libpak.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/debug/libpak.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/release/pak.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/debug/pak.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../libpak/libpak.a
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
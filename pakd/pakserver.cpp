@@ -0,0 +1,513 @@
+#include "pakserver.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QFile>
+#include <QtEndian>
+
+#include <climits>
+
+#if defined(Q_OS_UNIX) && !defined(QT_POSIX_IPC)
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
+
+static QJsonObject errorReply(const QString& error)
+{
+    QJsonObject reply;
+    reply["ok"] = false;
+    reply["error"] = error;
+    return reply;
+}
+
+PakServer::PakServer(QObject* parent) : QObject(parent)
+{
+    cacheSize = 256 * 1024 * 1024;
+    inlineLimit = 64 * 1024;
+    maxArchives = 64;
+    generationCounter = 0;
+    useCounter = 0;
+    segmentCounter = 0;
+    leaseCounter = 0;
+
+    clock.start();
+    leaseTimer.setInterval(1000);
+
+    connect(&server, &QLocalServer::newConnection, this, &PakServer::acceptConnections);
+    connect(&watcher, &QFileSystemWatcher::fileChanged, this, &PakServer::archiveChanged);
+    connect(&leaseTimer, &QTimer::timeout, this, &PakServer::expireLeases);
+}
+
+PakServer::~PakServer()
+{
+    leases.clear();
+    hotResources.clear();
+    qDeleteAll(archives);
+}
+
+bool PakServer::listen(const QString& name)
+{
+    // A socket file left behind by a daemon that died would make listen()
+    // fail, but one that still answers belongs to a running daemon
+    QLocalSocket probe;
+    probe.connectToServer(name);
+
+    if (probe.waitForConnected(100))
+    {
+        errorString = QString("A server is already listening on %1").arg(name);
+        return false;
+    }
+
+    QLocalServer::removeServer(name);
+
+    // Anything up to the inline limit is sent inline
+    if (inlineLimit > MAX_INLINE_SIZE)
+    {
+        inlineLimit = MAX_INLINE_SIZE;
+    }
+
+    // Cache costs are in KiB so caches over 2 GiB fit in an int
+    hotResources.setMaxCost(static_cast<int>(qMin<quint64>(cacheSize / 1024, INT_MAX)));
+
+    server.setSocketOptions(QLocalServer::UserAccessOption);
+
+    if (!server.listen(name))
+    {
+        errorString = server.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+void PakServer::acceptConnections()
+{
+    while (server.hasPendingConnections())
+    {
+        QLocalSocket* socket = server.nextPendingConnection();
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readRequests(socket); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() { releaseLeases(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+    }
+}
+
+void PakServer::archiveChanged(const QString& path)
+{
+    // Reopened by the next request for it, which also watches it again
+    // (replacing a file removes it from the watcher on some platforms)
+    dropArchive(path);
+}
+
+void PakServer::expireLeases()
+{
+    qint64 now = clock.elapsed();
+
+    for (QHash<quint64, Lease>::iterator it = leases.begin(); it != leases.end();)
+    {
+        it = it->expires <= now ? leases.erase(it) : it + 1;
+    }
+
+    if (leases.isEmpty())
+    {
+        leaseTimer.stop();
+    }
+}
+
+void PakServer::releaseLeases(QLocalSocket* socket)
+{
+    for (QHash<quint64, Lease>::iterator it = leases.begin(); it != leases.end();)
+    {
+        it = it->socket == socket ? leases.erase(it) : it + 1;
+    }
+}
+
+void PakServer::readRequests(QLocalSocket* socket)
+{
+    while (socket->bytesAvailable() >= 4)
+    {
+        QByteArray header = socket->peek(4);
+        quint32 length = qFromLittleEndian<quint32>(header.constData());
+
+        if (length > MAX_REQUEST_SIZE)
+        {
+            socket->abort();
+            return;
+        }
+
+        if (socket->bytesAvailable() < 4 + length)
+        {
+            return;
+        }
+
+        socket->read(4);
+
+        QJsonDocument document = QJsonDocument::fromJson(socket->read(length));
+        QByteArray payload;
+        QJsonObject reply;
+
+        if (document.isObject())
+        {
+            reply = handleRequest(socket, document.object(), &payload);
+        }
+        else
+        {
+            reply = errorReply("Request is not a JSON object");
+        }
+
+        sendReply(socket, reply, payload);
+    }
+}
+
+QJsonObject PakServer::handleRequest(QLocalSocket* socket, const QJsonObject& request, QByteArray* payload)
+{
+    QString op = request["op"].toString();
+    QString path = request["path"].toString();
+    QString error;
+
+    if (op == "release")
+    {
+        quint64 lease = request["lease"].toVariant().toULongLong();
+        QHash<quint64, Lease>::iterator it = leases.find(lease);
+
+        if (it == leases.end() || it->socket != socket)
+        {
+            return errorReply(QString("No lease %1").arg(lease));
+        }
+
+        leases.erase(it);
+
+        QJsonObject reply;
+        reply["ok"] = true;
+        return reply;
+    }
+
+    if (op != "list" && op != "stat" && op != "read")
+    {
+        return errorReply(QString("Unknown op \"%1\"").arg(op));
+    }
+
+    Archive* archive = this->archive(path, &error);
+
+    if (!archive)
+    {
+        return errorReply(error);
+    }
+
+    const QVector<PakFile::Resource>& resources = archive->pakFile->resources;
+    QJsonObject reply;
+
+    reply["ok"] = true;
+
+    if (op == "list")
+    {
+        QJsonArray list;
+
+        for (const PakFile::Resource& resource : resources)
+        {
+            QJsonObject entry;
+            entry["name"] = resource.name;
+            entry["size"] = static_cast<qint64>(resource.size);
+            list.append(entry);
+        }
+
+        reply["resources"] = list;
+        reply["generation"] = static_cast<qint64>(archive->generation);
+
+        return reply;
+    }
+
+    int index = findResource(archive, request, &error);
+
+    if (index == -1)
+    {
+        return errorReply(error);
+    }
+
+    const PakFile::Resource& resource = resources[index];
+
+    if (op == "stat")
+    {
+        reply["index"] = index;
+        reply["size"] = static_cast<qint64>(resource.size);
+        reply["generation"] = static_cast<qint64>(archive->generation);
+
+        return reply;
+    }
+
+    qint64 offset = request["offset"].toVariant().toLongLong();
+    qint64 length = request.contains("length") ? request["length"].toVariant().toLongLong() : resource.size;
+
+    if (offset < 0 || offset > resource.size || length < 0)
+    {
+        return errorReply("Read is outside the resource");
+    }
+
+    length = qMin<qint64>(length, resource.size - offset);
+    reply["size"] = length;
+
+    // Small reads of mapped data are sent straight from the mapping, which
+    // is already as hot as it gets; other resources go through the cache
+    const char* mapped = resource.data();
+    bool shared = resource.size > inlineLimit;
+
+    if (length > inlineLimit && !request["inline"].toBool())
+    {
+        HotResource* hot = hotResource(path, index, resource);
+
+        if (hot)
+        {
+            // The lease keeps the segment alive if the cache evicts it
+            // before the client is done with it
+            Lease lease;
+            lease.segment = hot->segment;
+            lease.socket = socket;
+            lease.expires = clock.elapsed() + LEASE_TIMEOUT_MS;
+            leases.insert(++leaseCounter, lease);
+            leaseTimer.start();
+
+            reply["sharedMemory"] = hot->segment->nativeKey();
+            reply["segmentSize"] = hot->segment->size();
+            reply["offset"] = offset;
+            reply["lease"] = static_cast<qint64>(leaseCounter);
+
+            return reply;
+        }
+    }
+
+    if (length > MAX_INLINE_SIZE)
+    {
+        return errorReply(QString("Reads of more than %1 bytes can't be sent inline").arg(MAX_INLINE_SIZE));
+    }
+
+    HotResource* hot = nullptr;
+
+    if (mapped)
+    {
+        *payload = QByteArray::fromRawData(mapped + offset, static_cast<int>(length));
+    }
+    else if (!shared && (hot = hotResource(path, index, resource)))
+    {
+        *payload = hot->data.mid(static_cast<int>(offset), static_cast<int>(length));
+    }
+    else
+    {
+        // Part of a big resource (or one the cache can't hold): read just
+        // that part
+        payload->resize(static_cast<int>(length));
+
+        if (!resource.read(static_cast<quint32>(offset), payload->data(), static_cast<quint32>(length)))
+        {
+            return errorReply(QString("Could not read %1").arg(resource.name));
+        }
+    }
+
+    reply["inline"] = true;
+
+    return reply;
+}
+
+PakServer::Archive* PakServer::archive(const QString& path, QString* error)
+{
+    if (!QDir::isAbsolutePath(path))
+    {
+        *error = QString("\"%1\" is not an absolute path").arg(path);
+        return nullptr;
+    }
+
+    QString key = QDir::cleanPath(path);
+    Archive* archive = archives.value(key);
+
+    if (archive)
+    {
+        archive->lastUsed = ++useCounter;
+        return archive;
+    }
+
+    // Make room by closing the archive that went unused the longest
+    if (maxArchives > 0 && archives.count() >= maxArchives)
+    {
+        QString oldest;
+        quint64 oldestUse = 0;
+
+        for (QHash<QString, Archive*>::const_iterator it = archives.constBegin(); it != archives.constEnd(); ++it)
+        {
+            if (oldest.isEmpty() || it.value()->lastUsed < oldestUse)
+            {
+                oldest = it.key();
+                oldestUse = it.value()->lastUsed;
+            }
+        }
+
+        dropArchive(oldest);
+    }
+
+    PakFile* pakFile = PakFile::open(key);
+
+    if (!pakFile)
+    {
+        *error = QString("Could not open %1 or it is not a valid PAK file").arg(key);
+        return nullptr;
+    }
+
+    archive = new Archive;
+    archive->pakFile.reset(pakFile);
+    archive->generation = ++generationCounter;
+    archive->lastUsed = ++useCounter;
+
+    const QVector<PakFile::Resource>& resources = pakFile->resources;
+
+    archive->nameIndex.reserve(resources.count());
+
+    // Walk backwards so the first of several equal names wins
+    for (int i = resources.count() - 1; i >= 0; i--)
+    {
+        archive->nameIndex.insert(resources[i].name, i);
+    }
+
+    archives.insert(key, archive);
+    watcher.addPath(key);
+
+    return archive;
+}
+
+void PakServer::dropArchive(const QString& path)
+{
+    delete archives.take(path);
+    watcher.removePath(path);
+
+    QString prefix = path + '\n';
+
+    for (const QString& key : hotResources.keys())
+    {
+        if (key.startsWith(prefix))
+        {
+            hotResources.remove(key);
+        }
+    }
+}
+
+int PakServer::findResource(Archive* archive, const QJsonObject& request, QString* error) const
+{
+    if (request.contains("name"))
+    {
+        QString name = request["name"].toString();
+        int index = archive->nameIndex.value(name, -1);
+
+        if (index == -1)
+        {
+            *error = QString("No resource named %1").arg(name);
+        }
+
+        return index;
+    }
+
+    int index = request["index"].toInt(-1);
+
+    if (index < 0 || index >= archive->pakFile->resources.count())
+    {
+        *error = "No resource name or a bad index";
+        return -1;
+    }
+
+    return index;
+}
+
+PakServer::HotResource* PakServer::hotResource(const QString& path, int index, const PakFile::Resource& resource)
+{
+    QString key = QDir::cleanPath(path) + '\n' + QString::number(index);
+    HotResource* hot = hotResources.object(key);
+
+    if (hot)
+    {
+        return hot;
+    }
+
+    // QSharedMemory and QByteArray sizes are ints
+    if (resource.size > INT_MAX)
+    {
+        return nullptr;
+    }
+
+    hot = new HotResource;
+
+    if (resource.size > inlineLimit)
+    {
+        QString name = QString("pakd-%1-%2").arg(QCoreApplication::applicationPid()).arg(++segmentCounter);
+
+        // A native key, so clients don't depend on how Qt derives one
+        hot->segment.reset(new QSharedMemory, &PakServer::destroySegment);
+#ifdef Q_OS_WIN
+        hot->segment->setNativeKey(name);
+#else
+        hot->segment->setNativeKey(QDir::temp().filePath(name));
+#endif
+
+        if (!hot->segment->create(static_cast<int>(resource.size)))
+        {
+            delete hot;
+            return nullptr;
+        }
+
+        // The server never writes to a segment again once it is filled, so
+        // clients don't need to lock it
+        if (!resource.read(0, static_cast<char*>(hot->segment->data()), resource.size))
+        {
+            delete hot;
+            return nullptr;
+        }
+    }
+    else
+    {
+        hot->data.resize(static_cast<int>(resource.size));
+
+        if (!resource.read(0, hot->data.data(), resource.size))
+        {
+            delete hot;
+            return nullptr;
+        }
+    }
+
+    // Fails (and deletes hot) when the resource is bigger than the cache
+    if (!hotResources.insert(key, hot, qMax<int>(1, resource.size / 1024)))
+    {
+        return nullptr;
+    }
+
+    return hot;
+}
+
+void PakServer::destroySegment(QSharedMemory* segment)
+{
+#if defined(Q_OS_UNIX) && !defined(QT_POSIX_IPC)
+    // Qt only removes a System V segment that nobody is attached to, so a
+    // client that never detached would leak it. Marking it removed frees
+    // it as soon as the last process detaches.
+    QString keyPath = segment->nativeKey();
+    int id = shmget(ftok(QFile::encodeName(keyPath).constData(), 'Q'), 0, 0);
+
+    if (id != -1)
+    {
+        shmctl(id, IPC_RMID, nullptr);
+    }
+
+    delete segment;
+    QFile::remove(keyPath);
+#else
+    delete segment;
+#endif
+}
+
+void PakServer::sendReply(QLocalSocket* socket, const QJsonObject& reply, const QByteArray& payload)
+{
+    QByteArray json = QJsonDocument(reply).toJson(QJsonDocument::Compact);
+    char length[4];
+
+    qToLittleEndian<quint32>(json.size(), length);
+
+    socket->write(length, sizeof(length));
+    socket->write(json);
+    socket->write(payload);
+}
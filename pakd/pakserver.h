@@ -0,0 +1,135 @@
+#ifndef PAKSERVER_H
+#define PAKSERVER_H
+
+#include <QCache>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include <QSharedMemory>
+#include <QSharedPointer>
+#include <QTimer>
+
+#include "pakfile.h"
+
+// Serves resources of PAK files to local clients, keeping archives open
+// (and mapped) between requests so a lookup costs a hash lookup instead of
+// opening and parsing the archive.
+//
+// Messages in both directions are a 4-byte little-endian length followed
+// by a compact JSON object. Requests have an "op" and the absolute "path"
+// of an archive:
+//
+//   { "op": "list", "path": "/data/level1.pak" }
+//   { "op": "stat", "path": "/data/level1.pak", "name": "player.dff" }
+//   { "op": "read", "path": "/data/level1.pak", "name": "player.dff",
+//     "offset": 0, "length": 4096, "inline": false }
+//
+// Resources are picked by "name" (the first with that name) or "index".
+// Replies have "ok" and, when it is false, an "error". A read reply gives
+// the "size" of the data returned; the data itself follows the reply when
+// "inline" is true. Inline data is limited to MAX_INLINE_SIZE, so bigger
+// reads have to be split with "offset" and "length".
+//
+// Reads over the inline limit are answered with a shared memory segment
+// holding the whole resource: its "sharedMemory" key, its "segmentSize",
+// the "offset" of the data in it and a "lease" number. Segments are shared
+// by every client reading that resource. The server keeps a segment alive
+// while any lease on it is held, even after it leaves the cache, so a
+// client must attach, copy what it needs, detach, and then give the lease
+// back:
+//
+//   { "op": "release", "lease": 42 }
+//
+// Leases not given back within LEASE_TIMEOUT_MS, or by the time the client
+// disconnects, are dropped, and a client still attached then can't rely on
+// the data any more. "inline": true in the request always gets the data
+// inline instead. Clients without Qt attach to a key this way:
+//
+//   Unix:    shmat(shmget(ftok(key, 'Q'), 0, 0), NULL, SHM_RDONLY)
+//            (System V shared memory; the key is the path of a file)
+//   Windows: MapViewOfFile(OpenFileMappingW(FILE_MAP_READ, FALSE, key),
+//            FILE_MAP_READ, 0, 0, 0)
+//
+// Archives are watched and dropped when they change on disk, together
+// with their cached resources, and reopened by the next request. At most
+// maxArchives are kept open; the least recently used one is dropped to
+// make room. "stat" replies include a "generation" that changes whenever
+// an archive is reopened.
+class PakServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    PakServer(QObject* parent = nullptr);
+    ~PakServer();
+
+    bool listen(const QString& name);
+
+    quint64 cacheSize;
+    quint32 inlineLimit;
+    int maxArchives;
+    QString errorString;
+
+private slots:
+    void acceptConnections();
+    void archiveChanged(const QString& path);
+    void expireLeases();
+
+private:
+    static const int MAX_REQUEST_SIZE = 64 * 1024;
+    static const int MAX_INLINE_SIZE = 64 * 1024 * 1024;
+    static const int LEASE_TIMEOUT_MS = 60 * 1000;
+
+    struct Archive
+    {
+        QScopedPointer<PakFile> pakFile;
+        QHash<QString, int> nameIndex;
+        quint64 generation;
+        quint64 lastUsed;
+    };
+
+    // A resource kept in memory, in a shared memory segment when it is too
+    // big to send inline
+    struct HotResource
+    {
+        QByteArray data;
+        QSharedPointer<QSharedMemory> segment;
+    };
+
+    // A segment handed to a client, kept until the client gives it back
+    struct Lease
+    {
+        QSharedPointer<QSharedMemory> segment;
+        QLocalSocket* socket;
+        qint64 expires;
+    };
+
+    QLocalServer server;
+    QFileSystemWatcher watcher;
+    QHash<QString, Archive*> archives;
+    QCache<QString, HotResource> hotResources;
+    QHash<quint64, Lease> leases;
+    QTimer leaseTimer;
+    QElapsedTimer clock;
+    quint64 generationCounter;
+    quint64 useCounter;
+    quint64 segmentCounter;
+    quint64 leaseCounter;
+
+    void readRequests(QLocalSocket* socket);
+    QJsonObject handleRequest(QLocalSocket* socket, const QJsonObject& request, QByteArray* payload);
+    Archive* archive(const QString& path, QString* error);
+    void dropArchive(const QString& path);
+    void releaseLeases(QLocalSocket* socket);
+    int findResource(Archive* archive, const QJsonObject& request, QString* error) const;
+    HotResource* hotResource(const QString& path, int index, const PakFile::Resource& resource);
+
+    static void destroySegment(QSharedMemory* segment);
+    static void sendReply(QLocalSocket* socket, const QJsonObject& reply, const QByteArray& payload);
+};
+
+#endif // PAKSERVER_H
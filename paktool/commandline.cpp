@@ -0,0 +1,1183 @@
+#include "commandline.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "pakbatch.h"
+#include "pakbuilder.h"
+#include "paklayout.h"
+#include "pakverifier.h"
+
+bool CommandLine::isCommand(const QString& name)
+{
+    return name == "build" || name == "verify" || name == "merge" || name == "split" || name == "analyze"
+        || name == "iobench" || name == "batch" || name == "help";
+}
+
+int CommandLine::run(const QStringList& arguments)
+{
+    QString command = arguments.value(1);
+    QStringList commandArguments = arguments.mid(2);
+
+    if (command == "build")
+    {
+        return build(commandArguments);
+    }
+    else if (command == "verify")
+    {
+        return verify(commandArguments);
+    }
+    else if (command == "merge")
+    {
+        return merge(commandArguments);
+    }
+    else if (command == "split")
+    {
+        return split(commandArguments);
+    }
+    else if (command == "analyze")
+    {
+        return analyze(commandArguments);
+    }
+    else if (command == "iobench")
+    {
+        return ioBench(commandArguments);
+    }
+    else if (command == "batch")
+    {
+        return batch(commandArguments);
+    }
+
+    return usage();
+}
+
+int CommandLine::build(const QStringList& arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    PakBuilder builder;
+    QString manifestPath;
+
+    for (int i = 0; i < arguments.count(); i++)
+    {
+        const QString& argument = arguments[i];
+
+        if (argument == "--force")
+        {
+            builder.force = true;
+        }
+        else if (argument == "--memory-budget" && i + 1 < arguments.count())
+        {
+            bool ok;
+            builder.memoryBudget = arguments[++i].toULongLong(&ok) * 1024 * 1024;
+
+            if (!ok)
+            {
+                return usage();
+            }
+        }
+        else if (argument.startsWith("--"))
+        {
+            return usage();
+        }
+        else if (manifestPath.isEmpty())
+        {
+            manifestPath = argument;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    if (manifestPath.isEmpty())
+    {
+        return usage();
+    }
+
+    if (!builder.loadManifest(manifestPath))
+    {
+        err << builder.errorString << "\n";
+        return 1;
+    }
+
+    return builder.build(out) ? 0 : 1;
+}
+
+int CommandLine::verify(const QStringList& arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    PakVerifier verifier;
+    QString path;
+    QString againstPath;
+    QString manifestPath;
+    QString writeManifestPath;
+
+    for (int i = 0; i < arguments.count(); i++)
+    {
+        const QString& argument = arguments[i];
+
+        if (argument == "--threads" && i + 1 < arguments.count())
+        {
+            bool ok;
+            verifier.threadCount = arguments[++i].toInt(&ok);
+
+            if (!ok || verifier.threadCount < 0)
+            {
+                return usage();
+            }
+        }
+        else if (argument == "--against" && i + 1 < arguments.count())
+        {
+            againstPath = arguments[++i];
+        }
+        else if (argument == "--manifest" && i + 1 < arguments.count())
+        {
+            manifestPath = arguments[++i];
+        }
+        else if (argument == "--write-manifest" && i + 1 < arguments.count())
+        {
+            writeManifestPath = arguments[++i];
+        }
+        else if (argument.startsWith("--"))
+        {
+            return usage();
+        }
+        else if (path.isEmpty())
+        {
+            path = argument;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    if (path.isEmpty() || (!againstPath.isEmpty() && !manifestPath.isEmpty()))
+    {
+        return usage();
+    }
+
+    QVector<PakVerifier::ResourceHash> reference;
+    QString referenceName;
+
+    if (!manifestPath.isEmpty())
+    {
+        QString error;
+
+        if (!PakVerifier::readManifest(manifestPath, &reference, &error))
+        {
+            err << error << "\n";
+            return 1;
+        }
+
+        referenceName = manifestPath;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    bool success = verifier.verify(path);
+
+    if (success && !againstPath.isEmpty())
+    {
+        PakVerifier referenceVerifier;
+        referenceVerifier.threadCount = verifier.threadCount;
+
+        if (!referenceVerifier.verify(againstPath))
+        {
+            for (const QString& error : referenceVerifier.errors)
+            {
+                err << againstPath << ": " << error << "\n";
+            }
+
+            return 1;
+        }
+
+        reference = referenceVerifier.hashes;
+        referenceName = againstPath;
+    }
+
+    if (success && !referenceName.isEmpty())
+    {
+        success = verifier.compare(reference, referenceName);
+    }
+
+    qint64 elapsed = timer.elapsed();
+
+    for (const QString& error : verifier.errors)
+    {
+        err << path << ": " << error << "\n";
+    }
+
+    if (!success)
+    {
+        return 1;
+    }
+
+    if (!writeManifestPath.isEmpty() && !PakVerifier::writeManifest(writeManifestPath, verifier.hashes))
+    {
+        err << "Could not write manifest " << writeManifestPath << "\n";
+        return 1;
+    }
+
+    out << path << ": OK, " << verifier.hashes.count() << " resources, "
+        << verifier.bytesHashed / (1024 * 1024) << " MiB in " << elapsed << " ms";
+
+    if (elapsed > 0)
+    {
+        out << " (" << (verifier.bytesHashed * 1000 / elapsed) / (1024 * 1024) << " MiB/s)";
+    }
+
+    out << "\n";
+
+    return 0;
+}
+
+int CommandLine::merge(const QStringList& arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    PakFile::MergePolicy policy = PakFile::PAKFILE_MERGE_ERROR;
+    QString outputPath;
+    QStringList inputPaths;
+    QString endian;
+    quint32 sectorSize = 0;
+    quint32 sizeAlign = 0;
+
+    for (int i = 0; i < arguments.count(); i++)
+    {
+        const QString& argument = arguments[i];
+
+        if (argument == "--policy" && i + 1 < arguments.count())
+        {
+            QString name = arguments[++i];
+
+            if (name == "first")
+            {
+                policy = PakFile::PAKFILE_MERGE_FIRST_WINS;
+            }
+            else if (name == "last")
+            {
+                policy = PakFile::PAKFILE_MERGE_LAST_WINS;
+            }
+            else if (name == "error")
+            {
+                policy = PakFile::PAKFILE_MERGE_ERROR;
+            }
+            else
+            {
+                return usage();
+            }
+        }
+        else if (!parseSettingOption(arguments, i, &endian, &sectorSize, &sizeAlign))
+        {
+            if (argument.startsWith("--"))
+            {
+                return usage();
+            }
+            else if (outputPath.isEmpty())
+            {
+                outputPath = argument;
+            }
+            else
+            {
+                inputPaths.append(argument);
+            }
+        }
+    }
+
+    if (outputPath.isEmpty() || inputPaths.empty())
+    {
+        return usage();
+    }
+
+    QVector<PakFile*> inputs;
+    QVector<const PakFile*> constInputs;
+    int result = 0;
+
+    for (QString& path : inputPaths)
+    {
+        PakFile* input = PakFile::open(path);
+
+        if (!input)
+        {
+            err << "Could not open " << path << "\n";
+            result = 1;
+            break;
+        }
+
+        // The output gets the settings of the first input
+        input->keepDiskAlignment();
+        inputs.append(input);
+        constInputs.append(input);
+    }
+
+    if (result == 0)
+    {
+        QString conflict;
+        QScopedPointer<PakFile> merged(PakFile::merge(constInputs, policy, &conflict));
+
+        if (!merged)
+        {
+            err << "Resource " << conflict << " exists in more than one archive\n";
+            result = 1;
+        }
+        else
+        {
+            merged->path = outputPath;
+            applySettings(merged.data(), endian, sectorSize, sizeAlign);
+
+            if (!merged->save())
+            {
+                err << "Could not write " << outputPath << "\n";
+                result = 1;
+            }
+            else
+            {
+                out << outputPath << ": " << merged->resources.count() << " resources\n";
+            }
+        }
+    }
+
+    qDeleteAll(inputs);
+
+    return result;
+}
+
+int CommandLine::split(const QStringList& arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    quint64 budget = 0;
+    QString inputPath;
+    QString outputPrefix;
+    QString endian;
+    quint32 sectorSize = 0;
+    quint32 sizeAlign = 0;
+
+    for (int i = 0; i < arguments.count(); i++)
+    {
+        const QString& argument = arguments[i];
+
+        if (argument == "--budget" && i + 1 < arguments.count())
+        {
+            budget = arguments[++i].toULongLong() * 1024 * 1024;
+        }
+        else if (!parseSettingOption(arguments, i, &endian, &sectorSize, &sizeAlign))
+        {
+            if (argument.startsWith("--"))
+            {
+                return usage();
+            }
+            else if (inputPath.isEmpty())
+            {
+                inputPath = argument;
+            }
+            else if (outputPrefix.isEmpty())
+            {
+                outputPrefix = argument;
+            }
+            else
+            {
+                return usage();
+            }
+        }
+    }
+
+    if (inputPath.isEmpty() || budget == 0)
+    {
+        return usage();
+    }
+
+    if (outputPrefix.isEmpty())
+    {
+        QFileInfo inputInfo(inputPath);
+        outputPrefix = inputInfo.dir().filePath(inputInfo.completeBaseName());
+    }
+
+    QScopedPointer<PakFile> input(PakFile::open(inputPath));
+
+    if (!input)
+    {
+        err << "Could not open " << inputPath << "\n";
+        return 1;
+    }
+
+    input->keepDiskAlignment();
+    applySettings(input.data(), endian, sectorSize, sizeAlign);
+
+    QVector<PakFile> parts = input->split(budget);
+
+    for (int i = 0; i < parts.count(); i++)
+    {
+        PakFile& part = parts[i];
+        part.path = QString("%1_%2.pak").arg(outputPrefix).arg(i, 2, 10, QChar('0'));
+
+        if (!part.save())
+        {
+            err << "Could not write " << part.path << "\n";
+            return 1;
+        }
+
+        out << part.path << ": " << part.resources.count() << " resources, "
+            << QFileInfo(part.path).size() << " bytes";
+
+        if (static_cast<quint64>(QFileInfo(part.path).size()) > budget)
+        {
+            out << " (over budget, " << part.resources.first().name << " alone is too big)";
+        }
+
+        out << "\n";
+    }
+
+    return 0;
+}
+
+// Size with a binary unit, for the size histogram labels
+static QString formatSize(quint64 size)
+{
+    const char* units[] = { "B", "KiB", "MiB", "GiB" };
+    int unit = 0;
+
+    while (unit < 3 && size >= 1024 && size % 1024 == 0)
+    {
+        size /= 1024;
+        unit++;
+    }
+
+    return QString("%1 %2").arg(size).arg(units[unit]);
+}
+
+static QString percentOf(quint64 part, quint64 whole)
+{
+    return QString::number(whole ? 100.0 * part / whole : 0.0, 'f', 1) + "%";
+}
+
+static void printSimulation(QTextStream& out, quint32 sectorSize, quint32 sizeAlign, PakLayout::Order order,
+                            quint64 size, quint64 actualSize)
+{
+    qint64 change = static_cast<qint64>(size) - static_cast<qint64>(actualSize);
+
+    out << "    " << QString::number(sectorSize).rightJustified(6) << " "
+        << QString::number(sizeAlign).rightJustified(6) << " "
+        << PakLayout::orderName(order).leftJustified(8) << ": "
+        << QString::number(size).rightJustified(12) << " "
+        << (change > 0 ? "+" : "") << change << " (" << percentOf(qAbs(change), actualSize) << ")\n";
+}
+
+int CommandLine::analyze(const QStringList& arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QStringList paths;
+    QVector<quint32> sectorSizes;
+    QVector<quint32> sizeAligns;
+    QVector<PakLayout::Order> orders;
+    bool listResources = false;
+
+    for (int i = 0; i < arguments.count(); i++)
+    {
+        const QString& argument = arguments[i];
+
+        if ((argument == "--sector-size" || argument == "--size-align") && i + 1 < arguments.count())
+        {
+            QVector<quint32>& values = argument == "--sector-size" ? sectorSizes : sizeAligns;
+
+            for (const QString& text : arguments[++i].split(','))
+            {
+                quint32 value = text.toUInt();
+
+                // Alignments must be powers of two
+                if (!value || (value & (value - 1)))
+                {
+                    return usage();
+                }
+
+                values.append(value);
+            }
+        }
+        else if (argument == "--order" && i + 1 < arguments.count())
+        {
+            for (const QString& text : arguments[++i].split(','))
+            {
+                PakLayout::Order order;
+
+                if (!PakLayout::parseOrder(text, &order))
+                {
+                    return usage();
+                }
+
+                orders.append(order);
+            }
+        }
+        else if (argument == "--resources")
+        {
+            listResources = true;
+        }
+        else if (argument.startsWith("--"))
+        {
+            return usage();
+        }
+        else
+        {
+            paths.append(argument);
+        }
+    }
+
+    if (paths.isEmpty())
+    {
+        return usage();
+    }
+
+    if (sectorSizes.isEmpty())
+    {
+        sectorSizes << 2048 << 512 << 64 << 16;
+    }
+
+    if (sizeAligns.isEmpty())
+    {
+        sizeAligns << 64;
+    }
+
+    if (orders.isEmpty())
+    {
+        orders << PakLayout::PAKLAYOUT_ORDER_CURRENT << PakLayout::PAKLAYOUT_ORDER_BEST;
+    }
+
+    // Totals over all archives, the simulated ones in the order printed
+    quint64 totalSize = 0;
+    quint64 totalWasted = 0;
+    QVector<quint64> totalSimulated(sectorSizes.count() * sizeAligns.count() * orders.count());
+    int result = 0;
+
+    for (QString path : paths)
+    {
+        QScopedPointer<PakFile> pakFile(PakFile::open(path));
+
+        if (!pakFile)
+        {
+            err << "Could not open " << path << "\n";
+            result = 1;
+            continue;
+        }
+
+        PakLayout layout = PakLayout::analyze(*pakFile);
+
+        totalSize += layout.pakSize;
+        totalWasted += layout.wasted();
+
+        out << path << ": " << layout.pakSize << " bytes, " << layout.resources.count() << " resources, "
+            << "offsets aligned to " << layout.sectorSize << ", size to " << layout.sizeAlign << "\n"
+            << "  header " << layout.headerSize << ", table " << layout.tableSize << ", names "
+            << layout.nameSize << " (" << percentOf(layout.headerSize + layout.tableSize + layout.nameSize, layout.pakSize)
+            << ")\n"
+            << "  data " << layout.dataSize << " (" << percentOf(layout.dataSize, layout.pakSize) << ")\n"
+            << "  padding " << layout.wasted() << " (" << percentOf(layout.wasted(), layout.pakSize) << "): "
+            << layout.tablePadding << " after the tables, " << layout.dataPadding << " between resources, "
+            << layout.tailPadding << " at the end\n";
+
+        out << "  sizes:\n";
+
+        for (const PakLayout::SizeBucket& bucket : layout.histogram)
+        {
+            if (bucket.count == 0)
+            {
+                continue;
+            }
+
+            out << "    < " << formatSize(bucket.limit).leftJustified(10) << QString::number(bucket.count).rightJustified(8)
+                << " resources" << QString::number(bucket.dataSize).rightJustified(14) << " bytes"
+                << QString::number(bucket.padding).rightJustified(12) << " padding\n";
+        }
+
+        if (listResources)
+        {
+            // Worst padded first
+            QVector<PakLayout::ResourceUsage> resources = layout.resources;
+
+            std::stable_sort(resources.begin(), resources.end(),
+                             [](const PakLayout::ResourceUsage& a, const PakLayout::ResourceUsage& b)
+                             { return a.padding > b.padding; });
+
+            out << "  resources (offset, size, padding):\n";
+
+            for (const PakLayout::ResourceUsage& usage : resources)
+            {
+                out << "    " << usage.name << " " << usage.offset << " " << usage.size << " " << usage.padding << "\n";
+            }
+        }
+
+        out << "  what if (sector size, size align, order: size, change):\n";
+
+        int simulation = 0;
+
+        for (quint32 sectorSize : sectorSizes)
+        {
+            for (quint32 sizeAlign : sizeAligns)
+            {
+                for (PakLayout::Order order : orders)
+                {
+                    PakLayout simulated = PakLayout::simulate(*pakFile, sectorSize, sizeAlign, order);
+
+                    totalSimulated[simulation++] += simulated.pakSize;
+                    printSimulation(out, sectorSize, sizeAlign, order, simulated.pakSize, layout.pakSize);
+                }
+            }
+        }
+    }
+
+    if (paths.count() > 1)
+    {
+        out << "total: " << totalSize << " bytes, padding " << totalWasted << " ("
+            << percentOf(totalWasted, totalSize) << ")\n";
+
+        int simulation = 0;
+
+        for (quint32 sectorSize : sectorSizes)
+        {
+            for (quint32 sizeAlign : sizeAligns)
+            {
+                for (PakLayout::Order order : orders)
+                {
+                    printSimulation(out, sectorSize, sizeAlign, order, totalSimulated[simulation++], totalSize);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+static QByteArray hashFile(const QString& path)
+{
+    QFile file(path);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    if (!file.open(QFile::ReadOnly) || !hash.addData(&file))
+    {
+        return QByteArray();
+    }
+
+    return hash.result();
+}
+
+// Evicts a file from the page cache, after writing back its dirty pages,
+// so the next run reads it from disk. Pages of mapping (a mapping of the
+// whole file) are unmapped from this process first, or they would stay.
+// Returns false where the cache can't be dropped.
+static bool dropFromCache(const QString& path, const char* mapping = nullptr, quint64 size = 0)
+{
+#ifdef Q_OS_LINUX
+    if (mapping)
+    {
+        madvise(const_cast<char*>(mapping), size, MADV_DONTNEED);
+    }
+
+    QFile file(path);
+
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    fdatasync(file.handle());
+
+    return posix_fadvise(file.handle(), 0, 0, POSIX_FADV_DONTNEED) == 0;
+#else
+    Q_UNUSED(path);
+    Q_UNUSED(mapping);
+    Q_UNUSED(size);
+    return false;
+#endif
+}
+
+static void printBench(QTextStream& out, const QString& name, qint64 nanoseconds, quint64 bytes)
+{
+    out << "  " << name.leftJustified(18) << QString::number(nanoseconds / 1000000.0, 'f', 1).rightJustified(10) << " ms";
+
+    if (nanoseconds > 0)
+    {
+        out << QString::number(bytes * 1000000000.0 / nanoseconds / (1024 * 1024), 'f', 1).rightJustified(10) << " MiB/s";
+    }
+
+    out << "\n";
+}
+
+int CommandLine::ioBench(const QStringList& arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QString path;
+    int repeat = 3;
+
+    for (int i = 0; i < arguments.count(); i++)
+    {
+        const QString& argument = arguments[i];
+
+        if (argument == "--repeat" && i + 1 < arguments.count())
+        {
+            repeat = qMax(1, arguments[++i].toInt());
+        }
+        else if (path.isEmpty() && !argument.startsWith("--"))
+        {
+            path = argument;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    if (path.isEmpty())
+    {
+        return usage();
+    }
+
+    QScopedPointer<PakFile> mapped(PakFile::open(path));
+    PakBufferRef fileData = PakFileBuffer::open(path);
+    QTemporaryDir dir;
+
+    if (!mapped || !fileData || !dir.isValid())
+    {
+        err << "Could not open " << path << "\n";
+        return 1;
+    }
+
+    // The same archive read with positioned reads instead of the mapping,
+    // so saving it has to copy every resource from file to file
+    PakFile unmapped = *mapped;
+
+    for (PakFile::Resource& resource : unmapped.resources)
+    {
+        resource.buffer = fileData;
+    }
+
+    // Reading every resource into memory, up to 1 GiB of them
+    QVector<PakIo::Read> reads;
+    QByteArray readData;
+    quint64 readSize = 0;
+
+    for (const PakFile::Resource& resource : mapped->resources)
+    {
+        if (readSize + resource.size > 1024 * 1024 * 1024)
+        {
+            break;
+        }
+
+        PakIo::Read read;
+        read.offset = resource.offset;
+        read.data = nullptr;
+        read.length = resource.size;
+        reads.append(read);
+
+        readSize += resource.size;
+    }
+
+    readData.resize(static_cast<int>(readSize));
+
+    for (int i = 0, position = 0; i < reads.count(); i++)
+    {
+        reads[i].data = readData.data() + position;
+        position += reads[i].length;
+    }
+
+    quint64 saveSize = mapped->layout().pakSize;
+    PakIo::Backend preferred = PakIo::preferredBackend();
+    QByteArray referenceHash;
+    int result = 0;
+
+    // Without dropping the cache, every run after the first reads from
+    // memory and the backends can't be told apart by their disk I/O
+    const char* mapping = mapped->data->data();
+    quint64 mappingSize = mapped->data->size();
+    bool cold = dropFromCache(path, mapping, mappingSize);
+
+    out << path << ": " << mapped->resources.count() << " resources, " << saveSize << " bytes, best of "
+        << repeat << (cold ? " (page cache dropped before every step)\n"
+                           : " (warm cache only: the page cache can't be dropped here)\n");
+
+    for (PakIo::Backend backend : { PakIo::PAKIO_BLOCKING, PakIo::PAKIO_URING })
+    {
+        QString name = PakIo::backendName(backend);
+
+        PakIo::setPreferredBackend(backend);
+
+        if (PakIo::instance()->backend() != backend)
+        {
+            out << name << ": not available\n";
+            continue;
+        }
+
+        qint64 bestRead = -1;
+        qint64 bestFileSave = -1;
+        qint64 bestMappedSave = -1;
+        QString fileSavePath = dir.filePath(name + "-file.pak");
+        QString mappedSavePath = dir.filePath(name + "-mapped.pak");
+
+        for (int run = 0; run < repeat && result == 0; run++)
+        {
+            QFile file(path);
+            QElapsedTimer timer;
+
+            if (cold)
+            {
+                dropFromCache(path, mapping, mappingSize);
+            }
+
+            timer.start();
+
+            if (!file.open(QFile::ReadOnly | QFile::Unbuffered) || !PakIo::instance()->read(&file, reads))
+            {
+                err << name << ": could not read " << path << "\n";
+                result = 1;
+                break;
+            }
+
+            qint64 elapsed = timer.nsecsElapsed();
+            bestRead = bestRead < 0 ? elapsed : qMin(bestRead, elapsed);
+
+            // Copies, so the sources stay bound to the original archive
+            PakFile fileCopy = unmapped;
+            PakFile mappedCopy = *mapped;
+
+            fileCopy.path = fileSavePath;
+            mappedCopy.path = mappedSavePath;
+
+            if (cold)
+            {
+                dropFromCache(path, mapping, mappingSize);
+            }
+
+            timer.restart();
+
+            if (!fileCopy.save())
+            {
+                err << name << ": could not write " << fileSavePath << "\n";
+                result = 1;
+                break;
+            }
+
+            elapsed = timer.nsecsElapsed();
+            bestFileSave = bestFileSave < 0 ? elapsed : qMin(bestFileSave, elapsed);
+
+            // The output is written back outside the timing, so it doesn't
+            // slow down the next step
+            if (cold)
+            {
+                dropFromCache(fileSavePath);
+                dropFromCache(path, mapping, mappingSize);
+            }
+
+            timer.restart();
+
+            if (!mappedCopy.save())
+            {
+                err << name << ": could not write " << mappedSavePath << "\n";
+                result = 1;
+                break;
+            }
+
+            elapsed = timer.nsecsElapsed();
+            bestMappedSave = bestMappedSave < 0 ? elapsed : qMin(bestMappedSave, elapsed);
+
+            if (cold)
+            {
+                dropFromCache(mappedSavePath);
+            }
+        }
+
+        if (result != 0)
+        {
+            break;
+        }
+
+        out << name << ":\n";
+        printBench(out, "read resources", bestRead, readSize);
+        printBench(out, "save from file", bestFileSave, saveSize);
+        printBench(out, "save from mapping", bestMappedSave, saveSize);
+
+        // Every backend has to write exactly the same bytes
+        QByteArray fileHash = hashFile(fileSavePath);
+
+        if (referenceHash.isEmpty())
+        {
+            referenceHash = fileHash;
+        }
+
+        if (fileHash.isEmpty() || fileHash != referenceHash || hashFile(mappedSavePath) != referenceHash)
+        {
+            err << name << ": output differs from the blocking backend\n";
+            result = 1;
+        }
+    }
+
+    PakIo::setPreferredBackend(preferred);
+
+    return result;
+}
+
+int CommandLine::batch(const QStringList& arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    PakBatch batch;
+    QString operation;
+    QString inputPath;
+    QString reportPath;
+    QString endian;
+    quint32 sectorSize = 0;
+    quint32 sizeAlign = 0;
+
+    for (int i = 0; i < arguments.count(); i++)
+    {
+        const QString& argument = arguments[i];
+
+        if (argument == "--threads" && i + 1 < arguments.count())
+        {
+            bool ok;
+            batch.threadCount = arguments[++i].toInt(&ok);
+
+            if (!ok || batch.threadCount < 0)
+            {
+                return usage();
+            }
+        }
+        else if (argument == "--memory-budget" && i + 1 < arguments.count())
+        {
+            bool ok;
+            batch.memoryBudget = arguments[++i].toULongLong(&ok) * 1024 * 1024;
+
+            if (!ok)
+            {
+                return usage();
+            }
+        }
+        else if (argument == "--output" && i + 1 < arguments.count())
+        {
+            batch.outputPath = arguments[++i];
+        }
+        else if (argument == "--report" && i + 1 < arguments.count())
+        {
+            reportPath = arguments[++i];
+        }
+        else if (!parseSettingOption(arguments, i, &endian, &sectorSize, &sizeAlign))
+        {
+            if (argument.startsWith("--"))
+            {
+                return usage();
+            }
+            else if (operation.isEmpty())
+            {
+                operation = argument;
+            }
+            else if (inputPath.isEmpty())
+            {
+                inputPath = argument;
+            }
+            else
+            {
+                return usage();
+            }
+        }
+    }
+
+    if (!PakBatch::parseOperation(operation, &batch.operation) || inputPath.isEmpty())
+    {
+        return usage();
+    }
+
+    if ((batch.operation == PakBatch::PAKBATCH_EXTRACT || batch.operation == PakBatch::PAKBATCH_REPACK) &&
+        batch.outputPath.isEmpty())
+    {
+        err << operation << " needs an --output directory\n";
+        return 2;
+    }
+
+    if (endian == "big")
+    {
+        batch.endian = PakFile::PAKFILE_BIG_ENDIAN;
+    }
+    else if (endian == "little")
+    {
+        batch.endian = PakFile::PAKFILE_LITTLE_ENDIAN;
+    }
+
+    batch.sectorSize = sectorSize;
+    batch.sizeAlign = sizeAlign;
+
+    bool success = batch.run(inputPath);
+    int failed = 0;
+    quint64 pakSize = 0;
+    quint64 padding = 0;
+    qint64 resourceCount = 0;
+    qint64 archiveMilliseconds = 0;
+
+    for (const PakBatch::Result& result : batch.results)
+    {
+        if (batch.operation == PakBatch::PAKBATCH_LIST)
+        {
+            for (const QString& line : result.resources)
+            {
+                out << result.path << "\t" << line << "\n";
+            }
+        }
+        else
+        {
+            out << result.path << ": " << (result.success ? "OK" : "FAILED") << ", " << result.resourceCount
+                << " resources, " << result.pakSize << " bytes, " << result.padding << " padding";
+
+            if (batch.operation == PakBatch::PAKBATCH_REPACK && result.success)
+            {
+                out << ", repacked to " << result.outputSize << " bytes";
+            }
+
+            out << ", " << result.milliseconds << " ms\n";
+        }
+
+        for (const QString& error : result.errors)
+        {
+            err << result.path << ": " << error << "\n";
+        }
+
+        failed += result.success ? 0 : 1;
+        pakSize += result.pakSize;
+        padding += result.padding;
+        resourceCount += result.resourceCount;
+        archiveMilliseconds += result.milliseconds;
+    }
+
+    // The summary goes to stderr so a listing on stdout stays clean
+    err << batch.results.count() << " archives, " << failed << " failed, " << resourceCount << " resources, "
+        << pakSize << " bytes, " << padding << " padding, " << batch.milliseconds << " ms ("
+        << archiveMilliseconds << " ms of archive work)\n";
+
+    if (!reportPath.isEmpty() && !batch.writeReport(reportPath))
+    {
+        err << "Could not write report " << reportPath << "\n";
+        return 1;
+    }
+
+    return success ? 0 : 1;
+}
+
+bool CommandLine::parseSettingOption(const QStringList& arguments, int& i, QString* endian,
+                                     quint32* sectorSize, quint32* sizeAlign)
+{
+    if (i + 1 >= arguments.count())
+    {
+        return false;
+    }
+
+    bool ok = true;
+
+    if (arguments[i] == "--endian")
+    {
+        *endian = arguments[++i];
+        ok = *endian == "big" || *endian == "little";
+    }
+    else if (arguments[i] == "--sector-size")
+    {
+        *sectorSize = arguments[++i].toUInt(&ok);
+        ok = ok && isPowerOfTwo(*sectorSize);
+    }
+    else if (arguments[i] == "--size-align")
+    {
+        *sizeAlign = arguments[++i].toUInt(&ok);
+        ok = ok && isPowerOfTwo(*sizeAlign);
+    }
+    else
+    {
+        return false;
+    }
+
+    return ok;
+}
+
+bool CommandLine::isPowerOfTwo(quint32 value)
+{
+    return value && !(value & (value - 1));
+}
+
+void CommandLine::applySettings(PakFile* pakFile, const QString& endian, quint32 sectorSize, quint32 sizeAlign)
+{
+    if (endian == "big")
+    {
+        pakFile->endian = PakFile::PAKFILE_BIG_ENDIAN;
+    }
+    else if (endian == "little")
+    {
+        pakFile->endian = PakFile::PAKFILE_LITTLE_ENDIAN;
+    }
+
+    if (sectorSize)
+    {
+        pakFile->sectorSize = sectorSize;
+    }
+
+    if (sizeAlign)
+    {
+        pakFile->sizeAlign = sizeAlign;
+    }
+}
+
+int CommandLine::usage()
+{
+    QTextStream err(stderr);
+
+    err << "Usage: PakTool <command> [arguments...]\n"
+           "\n"
+           "Commands:\n"
+           "  build [options] <manifest.json>   Build the PAK files listed in a manifest,\n"
+           "                                    skipping archives that are up to date\n"
+           "    --force                         Rebuild everything from the sources\n"
+           "    --memory-budget <MiB>           Stage sources above this in a temp file\n"
+           "  verify [options] <file.pak>       Check the structure of a PAK file and hash\n"
+           "                                    every resource\n"
+           "    --against <other.pak>           Compare with another PAK file\n"
+           "    --manifest <manifest.json>      Compare with a manifest or build record\n"
+           "    --write-manifest <out.json>     Write the resource hashes to a manifest\n"
+           "    --threads <n>                   Number of hashing threads\n"
+           "  merge [options] <out.pak> <in.pak>...\n"
+           "                                    Combine PAK files into one\n"
+           "    --policy first|last|error       What to do with duplicate names (error)\n"
+           "  split --budget <MiB> [options] <in.pak> [<out-prefix>]\n"
+           "                                    Split a PAK file into <out-prefix>_NN.pak\n"
+           "                                    files of at most the given size\n"
+           "  analyze [options] <file.pak>...   Show where the bytes of PAK files go and\n"
+           "                                    what other settings would save\n"
+           "    --sector-size <n>[,<n>...]      Sector sizes to try (2048,512,64,16)\n"
+           "    --size-align <n>[,<n>...]       Size alignments to try (64)\n"
+           "    --order <order>[,<order>...]    Orders to try: current, name, size, best\n"
+           "                                    (last resource pads least) (current,best)\n"
+           "    --resources                     List the padding of every resource\n"
+           "  iobench [--repeat <n>] <file.pak> Time reading and saving a PAK file with\n"
+           "                                    each I/O backend\n"
+           "  batch [options] <operation> <dir> Run list, verify, extract, repack or stats\n"
+           "                                    on every PAK file under a directory\n"
+           "    --output <dir>                  Where extract and repack write to\n"
+           "    --report <report.json>          Write a report of every archive\n"
+           "    --threads <n>                   Number of archives processed at once\n"
+           "    --memory-budget <MiB>           Archive data worked on at once (1024)\n"
+           "\n"
+           "merge, split and batch repack also take --endian big|little, --sector-size <n> and\n"
+           "--size-align <n> (powers of two) to change the settings of the output. Otherwise\n"
+           "the output keeps the defaults (2048 and 64) unless the padding of the (first)\n"
+           "input doesn't fit them.\n";
+
+    return 2;
+}
@@ -0,0 +1,35 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <QStringList>
+
+#include "pakfile.h"
+
+// Non-interactive commands, run as "PakTool <command> [arguments...]"
+// without creating any windows.
+class CommandLine
+{
+public:
+    static bool isCommand(const QString& name);
+    static int run(const QStringList& arguments);
+
+private:
+    static int build(const QStringList& arguments);
+    static int verify(const QStringList& arguments);
+    static int merge(const QStringList& arguments);
+    static int split(const QStringList& arguments);
+    static int analyze(const QStringList& arguments);
+    static int ioBench(const QStringList& arguments);
+    static int batch(const QStringList& arguments);
+
+    // Parses --endian, --sector-size or --size-align at arguments[i].
+    // Returns false for other arguments and for values that aren't big or
+    // little, or a power of two.
+    static bool parseSettingOption(const QStringList& arguments, int& i, QString* endian,
+                                   quint32* sectorSize, quint32* sizeAlign);
+    static bool isPowerOfTwo(quint32 value);
+    static void applySettings(PakFile* pakFile, const QString& endian, quint32 sectorSize, quint32 sizeAlign);
+    static int usage();
+};
+
+#endif // COMMANDLINE_H
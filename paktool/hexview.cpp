@@ -0,0 +1,133 @@
+#include "hexview.h"
+
+#include <QFontDatabase>
+#include <QPainter>
+#include <QScrollBar>
+
+HexView::HexView(QWidget* parent)
+    : QAbstractScrollArea(parent)
+{
+    windowOffset = 0;
+
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+}
+
+void HexView::setResource(const PakFile::Resource& resource)
+{
+    this->resource = resource;
+
+    window.clear();
+    windowOffset = 0;
+
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+
+    updateScrollBars();
+    viewport()->update();
+}
+
+void HexView::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(viewport());
+    QFontMetrics metrics(font());
+
+    quint64 firstLine = verticalScrollBar()->value();
+    quint64 offset = firstLine * BYTES_PER_LINE;
+
+    if (offset >= resource.size)
+    {
+        return;
+    }
+
+    quint32 length = qMin<quint64>(static_cast<quint64>(visibleLines() + 1) * BYTES_PER_LINE,
+                                   resource.size - offset);
+    const char* bytes = fetch(offset, length);
+
+    painter.translate(-horizontalScrollBar()->value(), 0);
+
+    for (quint32 line = 0; line * BYTES_PER_LINE < length; line++)
+    {
+        quint32 lineOffset = offset + line * BYTES_PER_LINE;
+        quint32 lineLength = qMin<quint32>(BYTES_PER_LINE, length - line * BYTES_PER_LINE);
+
+        QString hex;
+        QString ascii;
+
+        for (quint32 i = 0; i < BYTES_PER_LINE; i++)
+        {
+            if (i >= lineLength)
+            {
+                hex += "   ";
+                continue;
+            }
+
+            if (!bytes)
+            {
+                hex += "?? ";
+                ascii += '?';
+                continue;
+            }
+
+            uchar c = bytes[line * BYTES_PER_LINE + i];
+
+            hex += QString("%1 ").arg(static_cast<uint>(c), 2, 16, QChar('0'));
+            ascii += (c >= 0x20 && c < 0x7f) ? QLatin1Char(c) : QLatin1Char('.');
+        }
+
+        QString text = QString("%1  %2 %3").arg(lineOffset, 8, 16, QChar('0')).arg(hex, ascii);
+
+        painter.drawText(4, line * metrics.height() + metrics.ascent(), text);
+    }
+}
+
+void HexView::resizeEvent(QResizeEvent* event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    updateScrollBars();
+}
+
+int HexView::visibleLines() const
+{
+    return qMax(1, viewport()->height() / QFontMetrics(font()).height());
+}
+
+void HexView::updateScrollBars()
+{
+    QFontMetrics metrics(font());
+
+    int lineCount = (static_cast<quint64>(resource.size) + BYTES_PER_LINE - 1) / BYTES_PER_LINE;
+    int lineWidth = metrics.horizontalAdvance(QString(LINE_CHARS, 'F')) + 8;
+
+    verticalScrollBar()->setRange(0, qMax(0, lineCount - visibleLines()));
+    verticalScrollBar()->setPageStep(visibleLines());
+    verticalScrollBar()->setSingleStep(1);
+
+    horizontalScrollBar()->setRange(0, qMax(0, lineWidth - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+}
+
+const char* HexView::fetch(quint32 offset, quint32 length)
+{
+    if (offset >= windowOffset && offset + length <= windowOffset + static_cast<quint32>(window.size()))
+    {
+        return window.constData() + (offset - windowOffset);
+    }
+
+    // Read the visible page plus one page either side
+    quint32 start = offset > length ? offset - length : 0;
+    quint32 end = qMin<quint64>(static_cast<quint64>(offset) + 2 * length, resource.size);
+
+    window.resize(end - start);
+    windowOffset = start;
+
+    if (!resource.read(start, window.data(), end - start))
+    {
+        window.clear();
+        return nullptr;
+    }
+
+    return window.constData() + (offset - windowOffset);
+}
@@ -0,0 +1,37 @@
+#ifndef HEXVIEW_H
+#define HEXVIEW_H
+
+#include <QAbstractScrollArea>
+
+#include "pakfile.h"
+
+// Hex dump of a resource. Only the lines that are on screen are read from
+// the resource (plus a page either side to keep scrolling smooth), so even
+// huge resources open instantly.
+class HexView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    HexView(QWidget* parent = nullptr);
+
+    void setResource(const PakFile::Resource& resource);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+
+private:
+    static const int BYTES_PER_LINE = 16;
+    static const int LINE_CHARS = 8 + 2 + BYTES_PER_LINE * 3 + 1 + BYTES_PER_LINE;
+
+    PakFile::Resource resource;
+    QByteArray window;
+    quint32 windowOffset;
+
+    int visibleLines() const;
+    void updateScrollBars();
+    const char* fetch(quint32 offset, quint32 length);
+};
+
+#endif // HEXVIEW_H
@@ -0,0 +1,52 @@
+#include "mainwindow.h"
+#include "commandline.h"
+
+#include <QApplication>
+#include <QCoreApplication>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <cstdio>
+
+// PakTool is built as a GUI program, which Windows starts without a
+// console. Commands write to the console they were run from instead, unless
+// their output was redirected.
+static void attachParentConsole()
+{
+    bool outRedirected = GetStdHandle(STD_OUTPUT_HANDLE) != nullptr;
+    bool errRedirected = GetStdHandle(STD_ERROR_HANDLE) != nullptr;
+
+    if (!AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        return;
+    }
+
+    if (!outRedirected)
+    {
+        freopen("CONOUT$", "w", stdout);
+    }
+
+    if (!errRedirected)
+    {
+        freopen("CONOUT$", "w", stderr);
+    }
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && CommandLine::isCommand(QString::fromLocal8Bit(argv[1])))
+    {
+#ifdef Q_OS_WIN
+        attachParentConsole();
+#endif
+
+        QCoreApplication a(argc, argv);
+        return CommandLine::run(a.arguments());
+    }
+
+    QApplication a(argc, argv);
+    MainWindow w;
+    w.show();
+    return a.exec();
+}
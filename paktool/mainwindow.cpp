@@ -0,0 +1,921 @@
+﻿#include "mainwindow.h"
+
+#include <QApplication>
+#include <QMenuBar>
+#include <QMenu>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QPushButton>
+#include <QHeaderView>
+#include <QInputDialog>
+#include <QCloseEvent>
+#include <QSet>
+#include <QShortcut>
+#include <QRunnable>
+
+#include <algorithm>
+
+#include "resourceviewer.h"
+
+// Builds the trigrams of a copy of the name index away from the UI thread
+class NameIndexTask : public QRunnable
+{
+public:
+    NameIndexTask(MainWindow* window, int generation, const NameIndex& index)
+        : window(window), generation(generation), index(index)
+    {
+    }
+
+    void run() override
+    {
+        // Names changed again before this started
+        if (window->indexGeneration.loadAcquire() != generation)
+        {
+            return;
+        }
+
+        index.build();
+
+        MainWindow* window = this->window;
+        int generation = this->generation;
+        NameIndex index = this->index;
+
+        QMetaObject::invokeMethod(window, [=]()
+        {
+            window->indexBuilt(generation, index);
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    MainWindow* window;
+    int generation;
+    NameIndex index;
+};
+
+MainWindow::MainWindow(QWidget* parent)
+    : QMainWindow(parent)
+{
+    pakFile = nullptr;
+    undoEntries = 0;
+
+    // Only the latest build matters, so they run one at a time
+    indexPool.setMaxThreadCount(1);
+
+    QMenu* fileMenu = menuBar()->addMenu(tr("&File"));
+    fileMenu->addAction(tr("New PAK File"), this, &MainWindow::newPakFile);
+    fileMenu->addAction(tr("Open PAK File..."), this, &MainWindow::openPakFile);
+    QAction* saveAct = fileMenu->addAction(tr("Save PAK File"), this, QOverload<>::of(&MainWindow::savePakFile));
+    QAction* saveAsAct = fileMenu->addAction(tr("Save PAK File as..."), this, &MainWindow::savePakFileAs);
+    fileMenu->addSeparator();
+    fileMenu->addAction(tr("Exit"), this, &MainWindow::close);
+
+    connect(fileMenu, &QMenu::aboutToShow, this, [=]()
+    {
+        if (pakFile)
+        {
+            saveAct->setEnabled(true);
+            saveAsAct->setEnabled(true);
+        }
+        else
+        {
+            saveAct->setEnabled(false);
+            saveAsAct->setEnabled(false);
+        }
+    });
+
+    QMenu* editMenu = menuBar()->addMenu(tr("&Edit"));
+    QAction* undoAct = editMenu->addAction(tr("Undo"), this, &MainWindow::undo, QKeySequence::Undo);
+    QAction* redoAct = editMenu->addAction(tr("Redo"), this, &MainWindow::redo, QKeySequence::Redo);
+
+    connect(editMenu, &QMenu::aboutToShow, this, [=]()
+    {
+        undoAct->setEnabled(!undoStack.empty());
+        redoAct->setEnabled(!redoStack.empty());
+    });
+
+    resourceTableModel = new ResourceTableModel(this);
+
+    resourceTableView = new QTableView;
+    resourceTableView->setModel(resourceTableModel);
+    resourceTableView->verticalHeader()->hide();
+    resourceTableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    resourceTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    resourceTableView->setWordWrap(false);
+    resourceTableView->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    resourceTableView->horizontalHeader()->setSectionsClickable(false);
+
+    filterLineEdit = new QLineEdit;
+    filterLineEdit->setPlaceholderText(tr("Filter"));
+    filterLineEdit->setClearButtonEnabled(true);
+
+    filterModeComboBox = new QComboBox;
+    filterModeComboBox->addItem(tr("Substring"), NameIndex::NAMEINDEX_SUBSTRING);
+    filterModeComboBox->addItem(tr("Glob"), NameIndex::NAMEINDEX_GLOB);
+    filterModeComboBox->addItem(tr("Regex"), NameIndex::NAMEINDEX_REGEX);
+
+    // Substring and glob queries are answered from the name index as you
+    // type; regexes scan every name, so wait for a pause in typing.
+    filterTimer = new QTimer(this);
+    filterTimer->setSingleShot(true);
+    filterTimer->setInterval(150);
+
+    connect(filterTimer, &QTimer::timeout, this, &MainWindow::applyFilter);
+    connect(filterLineEdit, &QLineEdit::textChanged, this, [=]()
+    {
+        if (filterModeComboBox->currentData().toInt() == NameIndex::NAMEINDEX_REGEX)
+        {
+            filterTimer->start();
+        }
+        else
+        {
+            applyFilter();
+        }
+    });
+    connect(filterModeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::applyFilter);
+
+    QShortcut* findShortcut = new QShortcut(QKeySequence::Find, this);
+    connect(findShortcut, &QShortcut::activated, this, [=]()
+    {
+        filterLineEdit->setFocus();
+        filterLineEdit->selectAll();
+    });
+
+    QPushButton* importButton = new QPushButton(tr("Import"));
+    QPushButton* exportButton = new QPushButton(tr("Export"));
+    QPushButton* viewButton = new QPushButton(tr("View"));
+    QPushButton* replaceButton = new QPushButton(tr("Replace"));
+    QPushButton* moveUpButton = new QPushButton(tr("Move Up"));
+    QPushButton* moveDownButton = new QPushButton(tr("Move Down"));
+    QPushButton* renameButton = new QPushButton(tr("Rename"));
+    QPushButton* deleteButton = new QPushButton(tr("Delete"));
+
+    connect(importButton, &QPushButton::clicked, this, &MainWindow::importResource);
+    connect(exportButton, &QPushButton::clicked, this, QOverload<>::of(&MainWindow::exportResource));
+    connect(viewButton, &QPushButton::clicked, this, &MainWindow::viewResource);
+    connect(resourceTableView, &QTableView::doubleClicked, this, &MainWindow::viewResource);
+    connect(replaceButton, &QPushButton::clicked, this, &MainWindow::replaceResource);
+    connect(moveUpButton, &QPushButton::clicked, this, &MainWindow::moveResourceUp);
+    connect(moveDownButton, &QPushButton::clicked, this, &MainWindow::moveResourceDown);
+    connect(renameButton, &QPushButton::clicked, this, &MainWindow::renameResource);
+    connect(deleteButton, &QPushButton::clicked, this, &MainWindow::deleteResource);
+
+    QVBoxLayout* toolbarLayout = new QVBoxLayout;
+    toolbarLayout->addWidget(importButton);
+    toolbarLayout->addWidget(exportButton);
+    toolbarLayout->addWidget(viewButton);
+    toolbarLayout->addWidget(replaceButton);
+    //toolbarLayout->addWidget(moveUpButton);
+    //toolbarLayout->addWidget(moveDownButton);
+    toolbarLayout->addWidget(renameButton);
+    toolbarLayout->addWidget(deleteButton);
+    toolbarLayout->addStretch(1);
+
+    QHBoxLayout* filterLayout = new QHBoxLayout;
+    filterLayout->addWidget(filterLineEdit, 1);
+    filterLayout->addWidget(filterModeComboBox);
+
+    QVBoxLayout* tableLayout = new QVBoxLayout;
+    tableLayout->addLayout(filterLayout);
+    tableLayout->addWidget(resourceTableView, 1);
+
+    QHBoxLayout *mainLayout = new QHBoxLayout;
+    mainLayout->addLayout(tableLayout, 1);
+    mainLayout->addLayout(toolbarLayout);
+
+    QWidget* mainWidget = new QWidget;
+    mainWidget->setLayout(mainLayout);
+
+    setCentralWidget(mainWidget);
+    resize(640, 480);
+}
+
+MainWindow::~MainWindow()
+{
+    // Builds still queued skip themselves; a finished one's result is
+    // dropped along with this window's pending events
+    indexGeneration.fetchAndAddOrdered(1);
+    indexPool.waitForDone();
+}
+
+void MainWindow::updateWindowTitle()
+{
+    QString title = "";
+
+    if (pakFile)
+    {
+        if (pakFile->unsaved)
+        {
+            title += "*";
+        }
+
+        if (!pakFile->path.isEmpty())
+        {
+            QFileInfo fileInfo(pakFile->path);
+
+            title += fileInfo.fileName();
+        }
+        else
+        {
+            title += "Untitled";
+        }
+
+        title += " - ";
+    }
+
+    title += "PakTool";
+
+    setWindowTitle(title);
+}
+
+bool MainWindow::newPakFile()
+{
+    if (!maybeSave())
+    {
+        return false;
+    }
+
+    delete pakFile;
+    pakFile = new PakFile;
+
+    clearUndo();
+
+    resourceTableModel->setPakFile(pakFile);
+    refreshResourceTable();
+    updateWindowTitle();
+
+    return true;
+}
+
+bool MainWindow::openPakFile()
+{
+    QString path = QFileDialog::getOpenFileName(this, tr("Open PAK File"), QString(), "PAK File (*.pak)");
+
+    if (path.isEmpty())
+    {
+        return false;
+    }
+
+    if (!maybeSave())
+    {
+        return false;
+    }
+
+    delete pakFile;
+    pakFile = PakFile::open(path);
+
+    clearUndo();
+
+    if (!pakFile)
+    {
+        QMessageBox::warning(this, tr("Error opening PAK file"),
+                             QString(tr("Could not open file %1.")).arg(QFileInfo(path).fileName()));
+    }
+
+    resourceTableModel->setPakFile(pakFile);
+    refreshResourceTable();
+    updateWindowTitle();
+
+    return pakFile != nullptr;
+}
+
+bool MainWindow::savePakFile(QString& path)
+{
+    if (!pakFile)
+    {
+        return false;
+    }
+
+    pakFile->path = path;
+
+    bool success = pakFile->save();
+
+    updateWindowTitle();
+
+    return success;
+}
+
+bool MainWindow::savePakFile()
+{
+    if (!pakFile)
+    {
+        return false;
+    }
+
+    if (pakFile->path.isEmpty())
+    {
+        return savePakFileAs();
+    }
+
+    return savePakFile(pakFile->path);
+}
+
+bool MainWindow::savePakFileAs()
+{
+    if (!pakFile)
+    {
+        return false;
+    }
+
+    QString path = QFileDialog::getSaveFileName(this, tr("Save PAK File"), QString(), "PAK File (*.pak)");
+
+    if (path.isEmpty())
+    {
+        return false;
+    }
+
+    pakFile->path = path;
+
+    return savePakFile(pakFile->path);
+}
+
+bool MainWindow::maybeSave()
+{
+    if (pakFile && pakFile->unsaved)
+    {
+        QMessageBox::StandardButton answer =
+                QMessageBox::question(this, tr("Unsaved changes"), tr("You have unsaved changes. Save first?"),
+                                      QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+
+        if (answer == QMessageBox::Yes)
+        {
+            return savePakFile();
+        }
+        else if (answer == QMessageBox::No)
+        {
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MainWindow::loadResource(PakFile::Resource& resource, QString& path)
+{
+    if (!pakFile->loadResource(resource, path))
+    {
+        QMessageBox::warning(this, tr("Error importing resource"),
+                             QString(tr("Could not read file %1.")).arg(QFileInfo(path).fileName()));
+        return false;
+    }
+
+    return true;
+}
+
+void MainWindow::importResource()
+{
+    if (!pakFile)
+    {
+        return;
+    }
+
+    QStringList paths = QFileDialog::getOpenFileNames(this, tr("Import Resource(s)"));
+
+    if (paths.empty())
+    {
+        return;
+    }
+
+    bool undoPushed = false;
+
+    for (QString& path : paths)
+    {
+        PakFile::Resource resource;
+
+        if (!loadResource(resource, path))
+        {
+            continue;
+        }
+
+        if (!undoPushed)
+        {
+            pushUndo();
+            undoPushed = true;
+        }
+
+        pakFile->resources.append(resource);
+    }
+
+    refreshResourceTable();
+    resourceTableView->setFocus();
+
+    pakFile->unsaved = true;
+    updateWindowTitle();
+}
+
+void MainWindow::exportResource(PakFile::Resource& resource, QString& path)
+{
+    QFileInfo fileInfo(path);
+    QDir dir;
+    dir.mkpath(fileInfo.absolutePath());
+
+    QFile file(path);
+
+    if (!file.open(QFile::WriteOnly))
+    {
+        QMessageBox::warning(this, tr("Error exporting resource"),
+                             QString(tr("Could not open file %1 for writing.")).arg(resource.name));
+        return;
+    }
+
+    QVector<PakIo::Write> writes;
+    writes.append(resource.writeRequest(0));
+
+    if (!PakIo::instance()->write(&file, writes, resource.size))
+    {
+        QMessageBox::warning(this, tr("Error exporting resource"),
+                             QString(tr("Could not write file %1.")).arg(resource.name));
+        file.close();
+        return;
+    }
+
+    file.close();
+}
+
+void MainWindow::exportResource()
+{
+    if (!pakFile)
+    {
+        return;
+    }
+
+    QVector<int> selected = selectedResources();
+
+    if (selected.empty())
+    {
+        return;
+    }
+
+    QString folderPath = QFileDialog::getExistingDirectory(this, tr("Export Resource(s)"));
+
+    if (folderPath.isEmpty())
+    {
+        return;
+    }
+
+    for (int index : selected)
+    {
+        PakFile::Resource& resource = pakFile->resources[index];
+        QString path = QDir(folderPath).filePath(resource.name);
+
+        exportResource(resource, path);
+    }
+
+    resourceTableView->setFocus();
+}
+
+void MainWindow::viewResource()
+{
+    if (!pakFile)
+    {
+        return;
+    }
+
+    QVector<int> selected = selectedResources();
+
+    if (selected.empty())
+    {
+        return;
+    }
+
+    ResourceViewer* viewer = new ResourceViewer(pakFile->resources[selected.first()], this);
+    viewer->show();
+}
+
+void MainWindow::replaceResource()
+{
+    if (!pakFile)
+    {
+        return;
+    }
+
+    QVector<int> selected = selectedResources();
+
+    if (selected.empty())
+    {
+        return;
+    }
+
+    QString path = QFileDialog::getOpenFileName(this, tr("Replace Resource"));
+
+    if (path.isEmpty())
+    {
+        return;
+    }
+
+    PakFile::Resource resource;
+
+    if (!loadResource(resource, path))
+    {
+        return;
+    }
+
+    pushUndo();
+
+    pakFile->resources[selected.first()] = resource;
+
+    refreshResourceTable();
+    selectResources(selected);
+    resourceTableView->setFocus();
+
+    pakFile->unsaved = true;
+    updateWindowTitle();
+}
+
+void MainWindow::pushUndo()
+{
+    for (const PakFile& snapshot : redoStack)
+    {
+        removeSnapshot(snapshot);
+    }
+
+    redoStack.clear();
+    undoStack.append(*pakFile);
+    addSnapshot(undoStack.last());
+
+    trimUndoStack();
+}
+
+QSet<const PakBuffer*> MainWindow::buffersOf(const PakFile& pakFile)
+{
+    QSet<const PakBuffer*> buffers;
+    const PakBuffer* lastBuffer = nullptr;
+
+    for (const PakFile::Resource& resource : pakFile.resources)
+    {
+        // Most neighbouring resources share the archive buffer
+        if (resource.buffer.data() != lastBuffer)
+        {
+            lastBuffer = resource.buffer.data();
+            buffers.insert(lastBuffer);
+        }
+    }
+
+    buffers.remove(nullptr);
+
+    return buffers;
+}
+
+void MainWindow::addSnapshot(const PakFile& snapshot)
+{
+    undoEntries += snapshot.resources.count();
+
+    for (const PakBuffer* buffer : buffersOf(snapshot))
+    {
+        undoBufferRefs[buffer]++;
+    }
+}
+
+QVector<const PakBuffer*> MainWindow::removeSnapshot(const PakFile& snapshot)
+{
+    QVector<const PakBuffer*> released;
+
+    undoEntries -= snapshot.resources.count();
+
+    for (const PakBuffer* buffer : buffersOf(snapshot))
+    {
+        QHash<const PakBuffer*, int>::iterator it = undoBufferRefs.find(buffer);
+
+        if (--it.value() == 0)
+        {
+            undoBufferRefs.erase(it);
+            released.append(buffer);
+        }
+    }
+
+    return released;
+}
+
+void MainWindow::trimUndoStack()
+{
+    // Snapshots share their resource buffers with the open file, so they
+    // only cost their resource tables plus any buffers the open file no
+    // longer references (replaced imports, a previously saved archive...).
+    // Entries and buffer references are counted as snapshots come and go,
+    // so only the open file and the buffers snapshots hold are looked at
+    // here. Drop the oldest snapshots until all of that fits the limits.
+    QSet<const PakBuffer*> liveBuffers = buffersOf(*pakFile);
+    quint64 retainedBytes = 0;
+
+    for (QHash<const PakBuffer*, int>::const_iterator it = undoBufferRefs.constBegin();
+         it != undoBufferRefs.constEnd(); ++it)
+    {
+        if (!liveBuffers.contains(it.key()))
+        {
+            retainedBytes += it.key()->residentSize();
+        }
+    }
+
+    while (!undoStack.empty() &&
+           (undoStack.count() > MAX_UNDO_LEVELS ||
+            undoEntries > MAX_UNDO_ENTRIES ||
+            retainedBytes > MAX_UNDO_BYTES))
+    {
+        for (const PakBuffer* buffer : removeSnapshot(undoStack.first()))
+        {
+            if (!liveBuffers.contains(buffer))
+            {
+                retainedBytes -= buffer->residentSize();
+            }
+        }
+
+        undoStack.removeFirst();
+    }
+}
+
+void MainWindow::clearUndo()
+{
+    undoStack.clear();
+    redoStack.clear();
+    undoEntries = 0;
+    undoBufferRefs.clear();
+}
+
+void MainWindow::restoreSnapshot(const PakFile& snapshot)
+{
+    // Keep where the file lives on disk; only its contents are rewound
+    QString path = pakFile->path;
+
+    *pakFile = snapshot;
+    pakFile->path = path;
+    pakFile->unsaved = true;
+
+    refreshResourceTable();
+    updateWindowTitle();
+}
+
+void MainWindow::undo()
+{
+    if (!pakFile || undoStack.empty())
+    {
+        return;
+    }
+
+    redoStack.append(*pakFile);
+    addSnapshot(redoStack.last());
+    removeSnapshot(undoStack.last());
+    restoreSnapshot(undoStack.takeLast());
+}
+
+void MainWindow::redo()
+{
+    if (!pakFile || redoStack.empty())
+    {
+        return;
+    }
+
+    undoStack.append(*pakFile);
+    addSnapshot(undoStack.last());
+    removeSnapshot(redoStack.last());
+    restoreSnapshot(redoStack.takeLast());
+}
+
+void MainWindow::moveResourceUp()
+{
+    if (!pakFile)
+    {
+        return;
+    }
+
+    QVector<int> selected = selectedResources();
+
+    if (selected.empty())
+    {
+        return;
+    }
+
+    pushUndo();
+
+    int lastIndex = -1;
+
+    for (int& index : selected)
+    {
+        if (index > lastIndex + 1)
+        {
+            pakFile->resources.move(index, index - 1);
+            index--;
+        }
+
+        lastIndex = index;
+    }
+
+    refreshResourceTable();
+    selectResources(selected);
+    resourceTableView->setFocus();
+
+    pakFile->unsaved = true;
+    updateWindowTitle();
+}
+
+void MainWindow::moveResourceDown()
+{
+    if (!pakFile)
+    {
+        return;
+    }
+
+    QVector<int> selected = selectedResources();
+
+    if (selected.empty())
+    {
+        return;
+    }
+
+    pushUndo();
+
+    int firstIndex = pakFile->resources.count();
+
+    for (int i = selected.count() - 1; i >= 0; i--)
+    {
+        int& index = selected[i];
+
+        if (index < firstIndex - 1)
+        {
+            pakFile->resources.move(index, index + 1);
+            index++;
+        }
+
+        firstIndex = index;
+    }
+
+    refreshResourceTable();
+    selectResources(selected);
+    resourceTableView->setFocus();
+
+    pakFile->unsaved = true;
+    updateWindowTitle();
+}
+
+void MainWindow::renameResource()
+{
+    if (!pakFile)
+    {
+        return;
+    }
+
+    QVector<int> selected = selectedResources();
+
+    if (selected.empty())
+    {
+        return;
+    }
+
+    QString& currName = pakFile->resources[selected.first()].name;
+    bool ok;
+
+    QString newName =
+            QInputDialog::getText(this, tr("Rename Resource"), tr("Enter new resource name:"),
+                                  QLineEdit::Normal, currName, &ok);
+
+    if (!ok)
+    {
+        return;
+    }
+
+    pushUndo();
+
+    for (int index : selected)
+    {
+        pakFile->resources[index].name = newName;
+    }
+
+    refreshResourceTable();
+    selectResources(selected);
+    resourceTableView->setFocus();
+
+    pakFile->unsaved = true;
+    updateWindowTitle();
+}
+
+void MainWindow::deleteResource()
+{
+    if (!pakFile)
+    {
+        return;
+    }
+
+    QVector<int> selected = selectedResources();
+
+    if (selected.empty())
+    {
+        return;
+    }
+
+    pushUndo();
+
+    int firstRow = resourceTableModel->rowOfResource(selected.first());
+
+    for (int i = selected.count() - 1; i >= 0; i--)
+    {
+        pakFile->deleteResource(selected[i]);
+    }
+
+    refreshResourceTable();
+    resourceTableView->selectRow(qMin(firstRow, resourceTableModel->rowCount() - 1));
+    resourceTableView->setFocus();
+
+    pakFile->unsaved = true;
+    updateWindowTitle();
+}
+
+void MainWindow::refreshResourceTable()
+{
+    // Names may have changed. Filtering scans them until the new trigrams
+    // are built in the background, which keeps edits on huge archives from
+    // stalling the next keystroke.
+    QStringList names;
+
+    if (pakFile)
+    {
+        names.reserve(pakFile->resources.count());
+
+        for (const PakFile::Resource& resource : pakFile->resources)
+        {
+            names.append(resource.name);
+        }
+    }
+
+    nameIndex.setNames(names);
+    indexPool.start(new NameIndexTask(this, indexGeneration.fetchAndAddOrdered(1) + 1, nameIndex));
+
+    applyFilter();
+}
+
+void MainWindow::indexBuilt(int generation, const NameIndex& index)
+{
+    if (generation == indexGeneration.loadAcquire())
+    {
+        nameIndex = index;
+    }
+}
+
+void MainWindow::applyFilter()
+{
+    QString pattern = filterLineEdit->text();
+
+    filterTimer->stop();
+
+    if (!pakFile || pattern.isEmpty())
+    {
+        filterLineEdit->setStyleSheet(QString());
+        resourceTableModel->clearFilter();
+        return;
+    }
+
+    NameIndex::Mode mode = static_cast<NameIndex::Mode>(filterModeComboBox->currentData().toInt());
+    bool ok;
+
+    QVector<int> rows = nameIndex.filter(pattern, mode, &ok);
+
+    filterLineEdit->setStyleSheet(ok ? QString() : QString("color: red"));
+    resourceTableModel->setFilter(rows);
+}
+
+QVector<int> MainWindow::selectedResources() const
+{
+    QVector<int> indices;
+
+    for (const QModelIndex& index : resourceTableView->selectionModel()->selectedRows())
+    {
+        indices.append(resourceTableModel->resourceIndex(index.row()));
+    }
+
+    std::sort(indices.begin(), indices.end());
+
+    return indices;
+}
+
+void MainWindow::selectResources(const QVector<int>& indices)
+{
+    QItemSelection selection;
+
+    for (int index : indices)
+    {
+        int row = resourceTableModel->rowOfResource(index);
+
+        if (row >= 0)
+        {
+            selection.select(resourceTableModel->index(row, 0), resourceTableModel->index(row, 1));
+        }
+    }
+
+    resourceTableView->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect);
+}
+
+void MainWindow::closeEvent(QCloseEvent* event)
+{
+    if (!maybeSave())
+    {
+        event->ignore();
+    }
+    else
+    {
+        event->accept();
+    }
+}
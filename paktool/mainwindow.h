@@ -0,0 +1,91 @@
+#ifndef MAINWINDOW_H
+#define MAINWINDOW_H
+
+#include <QMainWindow>
+#include <QTableView>
+#include <QLineEdit>
+#include <QComboBox>
+#include <QTimer>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QHash>
+#include <QSet>
+
+#include "pakfile.h"
+#include "nameindex.h"
+#include "resourcetablemodel.h"
+
+class MainWindow : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    MainWindow(QWidget* parent = nullptr);
+    ~MainWindow();
+
+    bool savePakFile(QString& path);
+
+public slots:
+    bool newPakFile();
+    bool openPakFile();
+    bool savePakFile();
+    bool savePakFileAs();
+
+    void importResource();
+    void exportResource();
+    void viewResource();
+    void replaceResource();
+    void moveResourceUp();
+    void moveResourceDown();
+    void renameResource();
+    void deleteResource();
+
+    void undo();
+    void redo();
+
+    void applyFilter();
+
+private:
+    static const int MAX_UNDO_LEVELS = 100;
+    static const qint64 MAX_UNDO_ENTRIES = 4000000;
+    static const quint64 MAX_UNDO_BYTES = 512 * 1024 * 1024;
+
+    PakFile* pakFile;
+    QTableView* resourceTableView;
+    ResourceTableModel* resourceTableModel;
+    QLineEdit* filterLineEdit;
+    QComboBox* filterModeComboBox;
+    QTimer* filterTimer;
+    NameIndex nameIndex;
+    QThreadPool indexPool;
+    QAtomicInt indexGeneration;
+    QVector<PakFile> undoStack;
+    QVector<PakFile> redoStack;
+
+    // Resource entries in all snapshots, and how many snapshots hold each
+    // buffer
+    qint64 undoEntries;
+    QHash<const PakBuffer*, int> undoBufferRefs;
+
+    bool maybeSave();
+    void pushUndo();
+    void trimUndoStack();
+    void addSnapshot(const PakFile& snapshot);
+    QVector<const PakBuffer*> removeSnapshot(const PakFile& snapshot);
+    static QSet<const PakBuffer*> buffersOf(const PakFile& pakFile);
+    void clearUndo();
+    void restoreSnapshot(const PakFile& snapshot);
+    void refreshResourceTable();
+    void indexBuilt(int generation, const NameIndex& index);
+    void updateWindowTitle();
+    QVector<int> selectedResources() const;
+    void selectResources(const QVector<int>& indices);
+    void exportResource(PakFile::Resource& resource, QString& path);
+    bool loadResource(PakFile::Resource& resource, QString& path);
+
+    void closeEvent(QCloseEvent* event) override;
+
+    friend class NameIndexTask;
+};
+
+#endif // MAINWINDOW_H
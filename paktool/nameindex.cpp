@@ -0,0 +1,302 @@
+#include "nameindex.h"
+
+#include <QRegularExpression>
+
+NameIndex::NameIndex()
+{
+    built = false;
+    hasLast = false;
+    lastMode = NAMEINDEX_SUBSTRING;
+}
+
+void NameIndex::setNames(const QStringList& names)
+{
+    clear();
+
+    this->names = names;
+}
+
+void NameIndex::build()
+{
+    trigrams.clear();
+
+    for (int i = 0; i < names.count(); i++)
+    {
+        QString name = names[i].toLower();
+        const QChar* chars = name.constData();
+
+        for (int j = 0; j + 3 <= name.length(); j++)
+        {
+            QVector<int>& postings = trigrams[trigramKey(chars + j)];
+
+            // A trigram can occur several times in one name
+            if (postings.isEmpty() || postings.last() != i)
+            {
+                postings.append(i);
+            }
+        }
+    }
+
+    built = true;
+}
+
+void NameIndex::clear()
+{
+    built = false;
+    names.clear();
+    trigrams.clear();
+
+    hasLast = false;
+    lastPattern.clear();
+    lastResult.clear();
+}
+
+bool NameIndex::isBuilt() const
+{
+    return built;
+}
+
+QVector<int> NameIndex::filter(const QString& pattern, Mode mode, bool* ok)
+{
+    if (ok)
+    {
+        *ok = true;
+    }
+
+    QString needle = pattern.toLower();
+    QStringList literals;
+    QRegularExpression re;
+
+    if (mode == NAMEINDEX_SUBSTRING)
+    {
+        literals.append(needle);
+    }
+    else
+    {
+        QString expression = pattern;
+
+        if (mode == NAMEINDEX_GLOB)
+        {
+            expression = QRegularExpression::wildcardToRegularExpression(pattern);
+
+            // Runs of plain characters must appear in every match. On
+            // Windows a backslash or slash matches either separator, so
+            // those (and backslashes everywhere, to be safe) end a run too.
+            QString literal;
+
+            for (int i = 0; i < needle.length(); i++)
+            {
+                QChar c = needle[i];
+
+                if (c == '*' || c == '?' || c == '[' || isPathSeparator(c))
+                {
+                    literals.append(literal);
+                    literal.clear();
+
+                    if (c == '[')
+                    {
+                        while (i < needle.length() && needle[i] != ']')
+                        {
+                            i++;
+                        }
+                    }
+                }
+                else
+                {
+                    literal += c;
+                }
+            }
+
+            literals.append(literal);
+        }
+
+        re.setPattern(expression);
+        re.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+
+        if (!re.isValid())
+        {
+            if (ok)
+            {
+                *ok = false;
+            }
+
+            return hasLast ? lastResult : allIndices();
+        }
+
+        re.optimize();
+    }
+
+    // Candidates come from whichever is smaller: the rarest trigram of the
+    // pattern, or the previous result if this query can only narrow it.
+    const QVector<int>* candidates = built ? rarestPostingList(literals) : nullptr;
+
+    bool narrows = false;
+
+    if (hasLast && mode == lastMode)
+    {
+        if (mode == NAMEINDEX_SUBSTRING)
+        {
+            narrows = needle.contains(lastPattern);
+        }
+        else if (mode == NAMEINDEX_GLOB)
+        {
+            narrows = globNarrows(lastPattern, needle);
+        }
+    }
+
+    if (narrows)
+    {
+        if (!candidates || lastResult.count() < candidates->count())
+        {
+            candidates = &lastResult;
+        }
+    }
+
+    QVector<int> result;
+
+    if (candidates)
+    {
+        for (int i : *candidates)
+        {
+            if (mode == NAMEINDEX_SUBSTRING ? names[i].contains(needle, Qt::CaseInsensitive) : re.match(names[i]).hasMatch())
+            {
+                result.append(i);
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < names.count(); i++)
+        {
+            if (mode == NAMEINDEX_SUBSTRING ? names[i].contains(needle, Qt::CaseInsensitive) : re.match(names[i]).hasMatch())
+            {
+                result.append(i);
+            }
+        }
+    }
+
+    hasLast = true;
+    lastPattern = needle;
+    lastMode = mode;
+    lastResult = result;
+
+    return result;
+}
+
+bool NameIndex::isPathSeparator(QChar c)
+{
+#ifdef Q_OS_WIN
+    return c == '\\' || c == '/';
+#else
+    return c == '\\';
+#endif
+}
+
+bool NameIndex::globNarrows(const QString& oldPattern, const QString& newPattern)
+{
+    // Brackets may hold stars, so only patterns without them are compared
+    if (oldPattern.contains('[') || newPattern.contains('['))
+    {
+        return false;
+    }
+
+    QStringList oldParts = oldPattern.split('*');
+    QStringList newParts = newPattern.split('*');
+
+    if (oldParts.count() != newParts.count())
+    {
+        return false;
+    }
+
+    // Every match of the new pattern matches the old one if each part only
+    // gained plain characters next to a star, which the star absorbs. Stars
+    // stop at slashes, so those don't count as plain.
+    for (int i = 0; i < oldParts.count(); i++)
+    {
+        const QString& oldPart = oldParts[i];
+        const QString& newPart = newParts[i];
+        int start;
+
+        if (oldParts.count() == 1)
+        {
+            start = newPart == oldPart ? 0 : -1;
+        }
+        else if (i == 0)
+        {
+            start = newPart.startsWith(oldPart) ? 0 : -1;
+        }
+        else if (i == oldParts.count() - 1)
+        {
+            start = newPart.endsWith(oldPart) ? newPart.length() - oldPart.length() : -1;
+        }
+        else
+        {
+            start = newPart.indexOf(oldPart);
+        }
+
+        if (start < 0)
+        {
+            return false;
+        }
+
+        for (int j = 0; j < newPart.length(); j++)
+        {
+            QChar c = newPart[j];
+
+            if ((j < start || j >= start + oldPart.length()) && (c == '?' || c == '/' || isPathSeparator(c)))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+quint64 NameIndex::trigramKey(const QChar* chars)
+{
+    return (static_cast<quint64>(chars[0].unicode()) << 32) |
+           (static_cast<quint64>(chars[1].unicode()) << 16) |
+           static_cast<quint64>(chars[2].unicode());
+}
+
+const QVector<int>* NameIndex::rarestPostingList(const QStringList& literals) const
+{
+    static const QVector<int> noMatches;
+
+    const QVector<int>* rarest = nullptr;
+
+    for (const QString& literal : literals)
+    {
+        const QChar* chars = literal.constData();
+
+        for (int i = 0; i + 3 <= literal.length(); i++)
+        {
+            QHash<quint64, QVector<int>>::const_iterator it = trigrams.constFind(trigramKey(chars + i));
+
+            if (it == trigrams.constEnd())
+            {
+                return &noMatches;
+            }
+
+            if (!rarest || it->count() < rarest->count())
+            {
+                rarest = &it.value();
+            }
+        }
+    }
+
+    return rarest;
+}
+
+QVector<int> NameIndex::allIndices() const
+{
+    QVector<int> result(names.count());
+
+    for (int i = 0; i < names.count(); i++)
+    {
+        result[i] = i;
+    }
+
+    return result;
+}
@@ -0,0 +1,55 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Case-insensitive trigram index over a list of names, used to filter huge
+// resource lists interactively. Queries are answered from the rarest
+// trigram's posting list (or from the previous result when the new query
+// only narrows the old one) and then verified, so typing never rescans
+// every name unless the pattern is too short or is a free-form regex.
+// Until build() has run, queries scan the names; building can be done on a
+// copy in another thread and the result assigned back.
+class NameIndex
+{
+public:
+    enum Mode
+    {
+        NAMEINDEX_SUBSTRING = 0,
+        NAMEINDEX_GLOB = 1,
+        NAMEINDEX_REGEX = 2
+    };
+
+    NameIndex();
+
+    // Replaces the names and drops the trigrams
+    void setNames(const QStringList& names);
+    void build();
+    void clear();
+    bool isBuilt() const;
+
+    // Returns the indices of all matching names in ascending order. Sets ok
+    // to false (and returns the previous result) if the pattern is invalid.
+    QVector<int> filter(const QString& pattern, Mode mode, bool* ok = nullptr);
+
+private:
+    bool built;
+    QStringList names;
+    QHash<quint64, QVector<int>> trigrams;
+
+    bool hasLast;
+    QString lastPattern;
+    Mode lastMode;
+    QVector<int> lastResult;
+
+    static quint64 trigramKey(const QChar* chars);
+    static bool isPathSeparator(QChar c);
+    static bool globNarrows(const QString& oldPattern, const QString& newPattern);
+
+    const QVector<int>* rarestPostingList(const QStringList& literals) const;
+    QVector<int> allIndices() const;
+};
+
+#endif // NAMEINDEX_H
@@ -0,0 +1,48 @@
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = PakTool
+
+CONFIG += c++11
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+SOURCES += \
+    commandline.cpp \
+    hexview.cpp \
+    main.cpp \
+    mainwindow.cpp \
+    nameindex.cpp \
+    resourcetablemodel.cpp \
+    resourceviewer.cpp
+
+HEADERS += \
+    commandline.h \
+    hexview.h \
+    mainwindow.h \
+    nameindex.h \
+    resourcetablemodel.h \
+    resourceviewer.h
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../libpak/release/ -lpak
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../libpak/debug/ -lpak
+else:unix: LIBS += -L$$OUT_PWD/../libpak/ -lpak
+
+pak_io_uring: LIBS += -luring
+
+INCLUDEPATH += $$PWD/../libpak
+DEPENDPATH += $$PWD/../libpak
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/release/libpak.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/debug/libpak.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/release/pak.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../libpak/debug/pak.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../libpak/libpak.a
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
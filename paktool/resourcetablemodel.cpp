@@ -0,0 +1,105 @@
+#include "resourcetablemodel.h"
+
+#include <algorithm>
+
+ResourceTableModel::ResourceTableModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+    pakFile = nullptr;
+    filtered = false;
+}
+
+void ResourceTableModel::setPakFile(PakFile* pakFile)
+{
+    beginResetModel();
+    this->pakFile = pakFile;
+    filtered = false;
+    rows.clear();
+    endResetModel();
+}
+
+void ResourceTableModel::setFilter(const QVector<int>& resourceIndices)
+{
+    beginResetModel();
+    filtered = true;
+    rows = resourceIndices;
+    endResetModel();
+}
+
+void ResourceTableModel::clearFilter()
+{
+    beginResetModel();
+    filtered = false;
+    rows.clear();
+    endResetModel();
+}
+
+int ResourceTableModel::resourceIndex(int row) const
+{
+    return filtered ? rows[row] : row;
+}
+
+int ResourceTableModel::rowOfResource(int resourceIndex) const
+{
+    if (!filtered)
+    {
+        return resourceIndex;
+    }
+
+    // Filtered rows are kept in ascending resource order
+    QVector<int>::const_iterator it = std::lower_bound(rows.constBegin(), rows.constEnd(), resourceIndex);
+
+    if (it == rows.constEnd() || *it != resourceIndex)
+    {
+        return -1;
+    }
+
+    return it - rows.constBegin();
+}
+
+int ResourceTableModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid() || !pakFile)
+    {
+        return 0;
+    }
+
+    return filtered ? rows.count() : pakFile->resources.count();
+}
+
+int ResourceTableModel::columnCount(const QModelIndex& parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+
+    return 2;
+}
+
+QVariant ResourceTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!pakFile || !index.isValid() || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+
+    const PakFile::Resource& resource = pakFile->resources[resourceIndex(index.row())];
+
+    if (index.column() == 0)
+    {
+        return resource.name;
+    }
+
+    return QString::number(resource.size);
+}
+
+QVariant ResourceTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+
+    return section == 0 ? tr("Name") : tr("Size");
+}
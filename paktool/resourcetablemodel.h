@@ -0,0 +1,36 @@
+#ifndef RESOURCETABLEMODEL_H
+#define RESOURCETABLEMODEL_H
+
+#include <QAbstractTableModel>
+
+#include "pakfile.h"
+
+// Table model over a PakFile's resources. Rows can be restricted to a
+// subset of resource indices (the current name filter) without copying
+// anything, so the view stays responsive for very large archives.
+class ResourceTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    ResourceTableModel(QObject* parent = nullptr);
+
+    void setPakFile(PakFile* pakFile);
+    void setFilter(const QVector<int>& resourceIndices);
+    void clearFilter();
+
+    int resourceIndex(int row) const;
+    int rowOfResource(int resourceIndex) const;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    PakFile* pakFile;
+    bool filtered;
+    QVector<int> rows;
+};
+
+#endif // RESOURCETABLEMODEL_H
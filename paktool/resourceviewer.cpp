@@ -0,0 +1,94 @@
+#include "resourceviewer.h"
+
+#include <QLabel>
+#include <QVBoxLayout>
+
+#include "hexview.h"
+
+ResourceViewer::ResourceViewer(const PakFile::Resource& resource, QWidget* parent)
+    : QDialog(parent)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(resource.name + " - PakTool");
+
+    QLabel* infoLabel = new QLabel(QString(tr("%1 bytes, %2")).arg(resource.size).arg(sniffType(resource)));
+    infoLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+    hexView = new HexView;
+    hexView->setResource(resource);
+
+    QVBoxLayout* mainLayout = new QVBoxLayout;
+    mainLayout->addWidget(infoLabel);
+    mainLayout->addWidget(hexView, 1);
+
+    setLayout(mainLayout);
+    resize(720, 480);
+}
+
+QString ResourceViewer::sniffType(const PakFile::Resource& resource)
+{
+    struct Signature
+    {
+        quint32 offset;
+        const char* magic;
+        const char* type;
+    };
+
+    static const Signature signatures[] =
+    {
+        { 0, "HIPA", QT_TR_NOOP("HIP asset file") },
+        { 0, "BIKi", QT_TR_NOOP("Bink video") },
+        { 0, "BIKf", QT_TR_NOOP("Bink video") },
+        { 0, "BIKh", QT_TR_NOOP("Bink video") },
+        { 0, "KB2", QT_TR_NOOP("Bink 2 video") },
+        { 8, "WAVE", QT_TR_NOOP("WAVE audio") },
+        { 0, "OggS", QT_TR_NOOP("Ogg stream") },
+        { 0, "\x89PNG", QT_TR_NOOP("PNG image") },
+        { 0, "\xff\xd8\xff", QT_TR_NOOP("JPEG image") },
+        { 0, "DDS ", QT_TR_NOOP("DirectDraw surface") },
+        { 0, "GIF8", QT_TR_NOOP("GIF image") },
+        { 0, "BM", QT_TR_NOOP("Bitmap image") },
+        { 0, "pack", QT_TR_NOOP("PAK archive") },
+        { 0, "kcap", QT_TR_NOOP("PAK archive") },
+        { 0, "PK\x03\x04", QT_TR_NOOP("ZIP archive") },
+        { 0, "<?xml", QT_TR_NOOP("XML document") }
+    };
+
+    if (resource.size == 0)
+    {
+        return tr("empty");
+    }
+
+    QByteArray head(qMin<quint32>(resource.size, 512), Qt::Uninitialized);
+
+    if (!resource.read(0, head.data(), head.size()))
+    {
+        return tr("unreadable");
+    }
+
+    for (const Signature& signature : signatures)
+    {
+        if (head.mid(signature.offset).startsWith(signature.magic))
+        {
+            return tr(signature.type);
+        }
+    }
+
+    // Mostly printable bytes at the start suggest text
+    int printable = 0;
+
+    for (char c : head)
+    {
+        if ((c >= 0x20 && c < 0x7f) || c == '\t' || c == '\r' || c == '\n')
+        {
+            printable++;
+        }
+    }
+
+    if (printable * 100 >= head.size() * 95)
+    {
+        return tr("text");
+    }
+
+    return tr("unknown data");
+}
@@ -0,0 +1,27 @@
+#ifndef RESOURCEVIEWER_H
+#define RESOURCEVIEWER_H
+
+#include <QDialog>
+
+#include "pakfile.h"
+
+class HexView;
+
+// Window showing a resource's detected type and a hex dump of its data.
+// It holds its own reference to the resource data, so it stays valid even
+// if the resource is replaced or deleted while the window is open.
+class ResourceViewer : public QDialog
+{
+    Q_OBJECT
+
+public:
+    ResourceViewer(const PakFile::Resource& resource, QWidget* parent = nullptr);
+
+    // Guesses the type of a resource from its first few bytes
+    static QString sniffType(const PakFile::Resource& resource);
+
+private:
+    HexView* hexView;
+};
+
+#endif // RESOURCEVIEWER_H